@@ -13,6 +13,7 @@ CREATE TABLE IF NOT EXISTS tests (
   description TEXT,
   author_id INT REFERENCES users(id),
   is_published BOOLEAN NOT NULL DEFAULT FALSE,
+  time_limit_minutes INT CHECK (time_limit_minutes > 0), -- NULL: без ограничения
   created_at TIMESTAMP NOT NULL DEFAULT NOW(),
   updated_at TIMESTAMP NOT NULL DEFAULT NOW()
 );
@@ -22,9 +23,14 @@ CREATE TABLE IF NOT EXISTS questions (
   id SERIAL PRIMARY KEY,
   test_id INT NOT NULL REFERENCES tests(id) ON DELETE CASCADE,
   text TEXT NOT NULL,
-  position INT NOT NULL DEFAULT 0
+  type TEXT NOT NULL DEFAULT 'single', -- single, multiple, text
+  order_index INT NOT NULL DEFAULT 0
 );
 
+-- Базы, созданные старой схемой (с position вместо order_index)
+ALTER TABLE questions ADD COLUMN IF NOT EXISTS type TEXT NOT NULL DEFAULT 'single';
+ALTER TABLE questions ADD COLUMN IF NOT EXISTS order_index INT NOT NULL DEFAULT 0;
+
 -- Answers (варианты ответа)
 CREATE TABLE IF NOT EXISTS answers (
   id SERIAL PRIMARY KEY,
@@ -40,5 +46,13 @@ CREATE TABLE IF NOT EXISTS attempts (
   user_id INT REFERENCES users(id),
   started_at TIMESTAMP NOT NULL DEFAULT NOW(),
   finished_at TIMESTAMP,
-  score INT
+  score INT,
+  status TEXT NOT NULL DEFAULT 'in_progress' CHECK (status IN ('in_progress', 'finished', 'expired', 'cancelled')),
+  answers JSONB
 );
+
+-- Загрузка активных попыток в колесо таймеров при старте core-api
+CREATE INDEX IF NOT EXISTS idx_attempts_in_progress ON attempts(test_id) WHERE status = 'in_progress';
+
+-- Выгрузка попыток теста (GET /tests/{id}/attempts/export) читает их по индексу, без сортировки
+CREATE INDEX IF NOT EXISTS idx_attempts_test ON attempts(test_id, id);
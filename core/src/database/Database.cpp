@@ -1,9 +1,208 @@
 #include "Database.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
 #include <stdexcept>
 
-Database::Database(const std::string& conn_str) : conn_str_(conn_str) {
+namespace {
+
+// Реплика годится для чтения, только пока её WAL-приёмник в режиме streaming: при
+// оборванной репликации receive_lsn = replay_lsn тоже выполняется, а данные стареют.
+// Без роли pg_read_all_stats status виден как NULL — тогда достаточно наличия приёмника.
+// Реплика, которая проиграла всё полученное, считается догнавшей даже при
+// давнем pg_last_xact_replay_timestamp() (на простаивающем primary).
+// Второй столбец — проигранная позиция WAL для read-your-writes
+const char* const kLagQuery =
+    "SELECT CASE "
+    "WHEN NOT EXISTS (SELECT 1 FROM pg_stat_wal_receiver WHERE COALESCE(status, 'streaming') = 'streaming') THEN -1 "
+    "WHEN pg_last_wal_receive_lsn() = pg_last_wal_replay_lsn() THEN 0 "
+    "ELSE COALESCE(EXTRACT(EPOCH FROM now() - pg_last_xact_replay_timestamp()) * 1000, 0) END::bigint, "
+    "COALESCE(pg_wal_lsn_diff(pg_last_wal_replay_lsn(), '0/0'), 0)::bigint";
+
+const char* const kWriteLsnQuery = "SELECT pg_wal_lsn_diff(pg_current_wal_lsn(), '0/0')::bigint";
+
+// Недоступный узел не должен держать подключение дольше connect_timeout
+std::string with_connect_timeout(const std::string& conn_str, int64_t seconds) {
+    if (conn_str.find("connect_timeout") != std::string::npos) return conn_str;
+    std::string param = "connect_timeout=" + std::to_string(seconds);
+    if (conn_str.rfind("postgresql://", 0) == 0 || conn_str.rfind("postgres://", 0) == 0) {
+        return conn_str + (conn_str.find('?') == std::string::npos ? "?" : "&") + param;
+    }
+    return conn_str + " " + param;
+}
+
+} // namespace
+
+Database::Database(const std::string& conn_str, const std::vector<std::string>& replica_conn_strs)
+    : conn_str_(conn_str),
+      max_lag_ms_(env_ms("REPLICA_MAX_LAG_MS", 1000)),
+      lag_check_ms_(env_ms("REPLICA_LAG_CHECK_MS", 1000)),
+      sticky_ms_(env_ms("REPLICA_STICKY_MS", 5000)) {
     connection_ = std::make_unique<pqxx::connection>(conn_str);
     if (!connection_->is_open()) {
         throw std::runtime_error("Failed to open PostgreSQL connection");
     }
+    // Недоступная реплика не мешает старту: пока поток проверки её не подтвердит,
+    // чтения идут на primary
+    const int64_t connect_timeout_s = env_ms("REPLICA_CONNECT_TIMEOUT_S", 2);
+    for (const auto& rs : replica_conn_strs) {
+        replicas_.push_back(std::make_unique<Replica>());
+        replicas_.back()->conn_str = with_connect_timeout(rs, connect_timeout_s);
+    }
+    if (!replicas_.empty()) prober_ = std::thread([this] { probe_loop(); });
+}
+
+Database::~Database() {
+    {
+        std::lock_guard<std::mutex> lock(probe_mutex_);
+        stop_probe_ = true;
+    }
+    probe_cv_.notify_all();
+    if (prober_.joinable()) prober_.join();
+}
+
+int64_t Database::env_ms(const char* name, int64_t def) {
+    const char* v = std::getenv(name);
+    return v ? std::atoll(v) : def;
+}
+
+void Database::probe_loop() {
+    std::unique_lock<std::mutex> lock(probe_mutex_);
+    while (!stop_probe_) {
+        lock.unlock();
+        auto now = Clock::now();
+        for (auto& r : replicas_) {
+            if (now >= r->next_probe) probe(*r);
+        }
+        lock.lock();
+        probe_cv_.wait_for(lock, std::chrono::milliseconds(lag_check_ms_), [this] { return stop_probe_; });
+    }
+}
+
+void Database::probe(Replica& r) {
+    try {
+        if (!r.probe || !r.probe->is_open()) r.probe = std::make_unique<pqxx::connection>(r.conn_str);
+        int64_t lag;
+        int64_t replay_lsn;
+        {
+            pqxx::work tx{*r.probe};
+            auto res = tx.exec(kLagQuery);
+            tx.commit();
+            lag = res[0][0].as<int64_t>();
+            replay_lsn = res[0][1].as<int64_t>();
+        }
+        // Соединение для запросов открываем здесь же, а не в потоке сервера
+        if (lag >= 0 && r.connection_wanted.load() && !r.handover_ready.load()) {
+            auto conn = std::make_unique<pqxx::connection>(r.conn_str);
+            std::lock_guard<std::mutex> lock(r.handover_mutex);
+            r.handover = std::move(conn);
+            r.handover_ready.store(true);
+        }
+        if (lag < 0 && r.lag_ms.load() >= 0) std::cerr << "replica is not streaming WAL, reads go to primary" << std::endl;
+        // Позицию пишем раньше лага: поток сервера, увидевший новый лаг, видит и её.
+        // Значение отстаёт от реальной позиции не больше чем на период проверки —
+        // реплика может лишь зря уступить чтение primary, но не отдать старые данные
+        r.replay_lsn.store(replay_lsn);
+        r.lag_ms.store(lag);
+        r.failures = 0;
+    } catch (const std::exception& e) {
+        if (r.failures == 0) std::cerr << "replica unavailable: " << e.what() << std::endl;
+        r.lag_ms.store(-1);
+        r.probe.reset();
+        // Экспоненциальная пауза между попытками, не больше 30 с
+        r.failures = std::min(r.failures + 1, 6);
+        r.next_probe = Clock::now() + std::chrono::milliseconds(std::min<int64_t>(lag_check_ms_ << r.failures, 30000));
+    }
+}
+
+Database::Replica* Database::pick_replica() {
+    if (replicas_.empty()) return nullptr;
+
+    // Read-your-writes: после записи пользователя годится только реплика, которая
+    // уже проиграла WAL до позиции его commit
+    int64_t need_lsn = 0;
+    if (current_user_ != 0) {
+        auto it = last_write_.find(current_user_);
+        if (it != last_write_.end()) {
+            if (Clock::now() - it->second.at >= std::chrono::milliseconds(sticky_ms_)) last_write_.erase(it);
+            else need_lsn = it->second.lsn;
+        }
+    }
+
+    for (size_t k = 0; k < replicas_.size(); ++k) {
+        Replica& r = *replicas_[(next_replica_ + k) % replicas_.size()];
+        int64_t lag = r.lag_ms.load();
+        if (lag < 0 || lag > max_lag_ms_) continue;
+        if (r.replay_lsn.load() < need_lsn) continue;
+        if (!r.connection && r.handover_ready.load()) {
+            std::lock_guard<std::mutex> lock(r.handover_mutex);
+            r.connection = std::move(r.handover);
+            r.handover_ready.store(false);
+            r.connection_wanted.store(false);
+        }
+        if (!r.connection) continue;
+        next_replica_ = (next_replica_ + k + 1) % replicas_.size();
+        used_replicas_.push_back(&r);
+        return &r;
+    }
+    return nullptr;
+}
+
+bool Database::drop_request_replicas() {
+    if (used_replicas_.empty()) return false;
+    for (Replica* r : used_replicas_) {
+        r->connection.reset();
+        r->lag_ms.store(-1);
+        r->connection_wanted.store(true);
+    }
+    used_replicas_.clear();
+    return true;
+}
+
+pqxx::connection& Database::read_connection() {
+    Replica* r = pick_replica();
+    return r ? *r->connection : *connection_;
+}
+
+std::string Database::read_connection_string() {
+    Replica* r = pick_replica();
+    return r ? r->conn_str : conn_str_;
+}
+
+void Database::note_write() {
+    if (current_user_ == 0 || replicas_.empty()) return;
+    // Транзакция уже зафиксирована, так что текущая позиция WAL не меньше её commit.
+    // Не удалось узнать позицию — до истечения отметки читаем этого пользователя с primary
+    int64_t lsn = std::numeric_limits<int64_t>::max();
+    try {
+        pqxx::nontransaction tx{*connection_};
+        lsn = tx.exec(kWriteLsnQuery)[0][0].as<int64_t>();
+    } catch (const std::exception& e) {
+        std::cerr << "pg_current_wal_lsn failed: " << e.what() << std::endl;
+    }
+    auto now = Clock::now();
+    last_write_[current_user_] = WriteMark{now, lsn};
+    // Не даём карте расти бесконечно: выкидываем истёкшие отметки
+    if (last_write_.size() > 10000) {
+        for (auto it = last_write_.begin(); it != last_write_.end();) {
+            if (now - it->second.at >= std::chrono::milliseconds(sticky_ms_)) it = last_write_.erase(it);
+            else ++it;
+        }
+    }
+}
+
+namespace {
+thread_local uint64_t db_time_us = 0;
+}
+
+Database::Timer::~Timer() {
+    auto elapsed = std::chrono::steady_clock::now() - start_;
+    db_time_us += std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+}
+
+uint64_t Database::take_time_us() {
+    uint64_t t = db_time_us;
+    db_time_us = 0;
+    return t;
 }
@@ -1,22 +1,111 @@
 #pragma once
 #include <pqxx/pqxx>
+#include "../trace/Trace.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 class Database {
 public:
-    explicit Database(const std::string& conn_str);
+    // replica_conn_strs — реплики только для чтения (могут быть пустыми)
+    explicit Database(const std::string& conn_str, const std::vector<std::string>& replica_conn_strs = {});
+    ~Database();
+    Database(const Database&) = delete;
+    Database& operator=(const Database&) = delete;
 
-    // Доступ к соединению для сервисов
+    // Доступ к соединению для сервисов (primary: запись и чтение сразу после записи)
     pqxx::connection& connection() { return *connection_; }
 
     // Добавляем совместимость с вызовами db.conn()
     pqxx::connection& conn() { return *connection_; }
 
+    // Соединение для методов только для чтения: реплика с допустимым лагом,
+    // которая уже видит последнюю запись текущего пользователя, иначе primary
+    pqxx::connection& read_connection();
+    // Строка подключения того же узла, что выбрал бы read_connection()
+    std::string read_connection_string();
+
+    // Read-your-writes: текущий пользователь запроса (0 — анонимный)
+    void begin_request(int user_id) { current_user_ = user_id; used_replicas_.clear(); }
+    // Вызывается сервисами после commit() изменяющей транзакции: запоминает позицию
+    // WAL primary, которую реплика должна проиграть, прежде чем читать с неё
+    void note_write();
+
+    // После pqxx::broken_connection: закрывает соединения реплик, выданные в этом
+    // запросе, и не выбирает их до следующей успешной проверки. true — реплики были,
+    // и чтение можно повторить (оно уйдёт на primary)
+    bool drop_request_replicas();
+
     // Для health-check
     std::string get_connection_string() const { return conn_str_; }
 
+    // Замер времени работы с БД: ставится в начале метода сервиса,
+    // время копится в текущем потоке до take_time_us() (журнал доступа),
+    // а в трассу запроса пишется спан name категории "db"
+    class Timer {
+    public:
+        explicit Timer(const char* name = "db") : span_(name, "db"), start_(std::chrono::steady_clock::now()) {}
+        ~Timer();
+    private:
+        trace::Span span_;
+        std::chrono::steady_clock::time_point start_;
+    };
+
+    // Накопленное с прошлого вызова время БД в текущем потоке, мкс
+    static uint64_t take_time_us();
+
 private:
+    using Clock = std::chrono::steady_clock;
+
+    // Лаг реплик проверяет фоновый поток на своих соединениях: подключение к
+    // недоступному узлу (до connect_timeout) не задерживает запросы. Он же открывает
+    // соединение для запросов и передаёт его потоку сервера через handover.
+    struct Replica {
+        std::string conn_str;
+        std::atomic<int64_t> lag_ms{-1};              // -1 — недоступна или не получает WAL
+        std::atomic<int64_t> replay_lsn{0};           // pg_last_wal_replay_lsn() в байтах
+        std::unique_ptr<pqxx::connection> connection;  // только поток сервера
+        std::atomic<bool> connection_wanted{true};
+        std::atomic<bool> handover_ready{false};
+        std::mutex handover_mutex;
+        std::unique_ptr<pqxx::connection> handover;
+        // Только поток проверки
+        std::unique_ptr<pqxx::connection> probe;
+        int failures = 0;
+        Clock::time_point next_probe{};
+    };
+
+    Replica* pick_replica();
+    void probe_loop();
+    void probe(Replica& r);
+    static int64_t env_ms(const char* name, int64_t def);
+
     std::unique_ptr<pqxx::connection> connection_;
     std::string conn_str_;
+
+    // Маршрутизация — только поток сервера; с потоком проверки общие лишь атомики и handover
+    std::vector<std::unique_ptr<Replica>> replicas_;
+    std::vector<Replica*> used_replicas_;
+    size_t next_replica_ = 0;
+    int64_t max_lag_ms_;
+    int64_t lag_check_ms_;
+    int64_t sticky_ms_;
+    int current_user_ = 0;
+    struct WriteMark {
+        Clock::time_point at;
+        int64_t lsn;  // pg_current_wal_lsn() после commit, в байтах
+    };
+    std::unordered_map<int, WriteMark> last_write_;
+
+    std::mutex probe_mutex_;
+    std::condition_variable probe_cv_;
+    bool stop_probe_ = false;
+    std::thread prober_;
 };
@@ -0,0 +1,163 @@
+#include "AccessLog.hpp"
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+
+namespace http {
+
+namespace {
+
+size_t round_up_pow2(size_t n) {
+  size_t p = 1;
+  while (p < n) p <<= 1;
+  return p;
+}
+
+// Экранирование для JSON: route/method приходят из запроса как есть
+void append_json_string(std::string& out, const char* s, size_t max_len) {
+  out += '"';
+  for (size_t i = 0; i < max_len && s[i]; ++i) {
+    unsigned char c = static_cast<unsigned char>(s[i]);
+    if (c == '"' || c == '\\') { out += '\\'; out += static_cast<char>(c); }
+    else if (c < 0x20) { char buf[8]; std::snprintf(buf, sizeof(buf), "\\u%04x", c); out += buf; }
+    else out += static_cast<char>(c);
+  }
+  out += '"';
+}
+
+} // namespace
+
+AccessLog::AccessLog(std::string path, size_t capacity, size_t max_file_bytes, int keep_files)
+  : cells_(new Cell[round_up_pow2(capacity)]),
+    mask_(round_up_pow2(capacity) - 1),
+    path_(std::move(path)),
+    max_file_bytes_(max_file_bytes),
+    keep_files_(keep_files) {
+  for (size_t i = 0; i <= mask_; ++i) cells_[i].seq.store(i, std::memory_order_relaxed);
+  open_file();
+  worker_ = std::thread([this] { run(); });
+}
+
+AccessLog::~AccessLog() {
+  stop_.store(true, std::memory_order_release);
+  if (worker_.joinable()) worker_.join();
+  if (file_) std::fclose(file_);
+}
+
+void AccessLog::set_text(char* dst, size_t cap, const std::string& src) {
+  size_t n = src.size() < cap - 1 ? src.size() : cap - 1;
+  std::memcpy(dst, src.data(), n);
+  dst[n] = '\0';
+}
+
+bool AccessLog::log(const AccessRecord& rec) {
+  size_t pos = head_.load(std::memory_order_relaxed);
+  for (;;) {
+    Cell& cell = cells_[pos & mask_];
+    size_t seq = cell.seq.load(std::memory_order_acquire);
+    intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+    if (diff == 0) {
+      if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+        cell.rec = rec;
+        cell.seq.store(pos + 1, std::memory_order_release);
+        return true;
+      }
+    } else if (diff < 0) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    } else {
+      pos = head_.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+bool AccessLog::pop(AccessRecord& out) {
+  Cell& cell = cells_[tail_ & mask_];
+  size_t seq = cell.seq.load(std::memory_order_acquire);
+  if (seq != tail_ + 1) return false;
+  out = cell.rec;
+  cell.seq.store(tail_ + mask_ + 1, std::memory_order_release);
+  ++tail_;
+  return true;
+}
+
+void AccessLog::run() {
+  AccessRecord rec;
+  for (;;) {
+    bool any = false;
+    while (pop(rec)) {
+      write_line(rec);
+      any = true;
+    }
+    uint64_t dropped = dropped_.load(std::memory_order_relaxed);
+    if (dropped != reported_dropped_ && file_) {
+      file_bytes_ += std::fprintf(file_, "{\"dropped\":%llu}\n",
+                                  static_cast<unsigned long long>(dropped - reported_dropped_));
+      reported_dropped_ = dropped;
+      any = true;
+    }
+    if (any && file_) std::fflush(file_);
+    if (!any) {
+      if (stop_.load(std::memory_order_acquire)) return;
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+  }
+}
+
+void AccessLog::open_file() {
+  file_ = std::fopen(path_.c_str(), "a");
+  if (!file_) {
+    std::cerr << "access log: cannot open " << path_ << std::endl;
+    return;
+  }
+  std::fseek(file_, 0, SEEK_END);
+  file_bytes_ = static_cast<size_t>(std::ftell(file_));
+}
+
+void AccessLog::rotate() {
+  if (file_) std::fclose(file_);
+  file_ = nullptr;
+  // access.log.(N-1) -> access.log.N, ..., access.log -> access.log.1
+  for (int i = keep_files_ - 1; i >= 1; --i) {
+    std::rename((path_ + "." + std::to_string(i)).c_str(), (path_ + "." + std::to_string(i + 1)).c_str());
+  }
+  if (keep_files_ > 0) std::rename(path_.c_str(), (path_ + ".1").c_str());
+  else std::remove(path_.c_str());
+  open_file();
+}
+
+void AccessLog::write_line(const AccessRecord& rec) {
+  if (!file_) return;
+  std::time_t secs = static_cast<std::time_t>(rec.ts_us / 1000000);
+  std::tm tm{};
+  gmtime_r(&secs, &tm);
+  char ts[40];
+  std::snprintf(ts, sizeof(ts), "%04d-%02d-%02dT%02d:%02d:%02d.%06uZ",
+                tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec,
+                static_cast<unsigned>(rec.ts_us % 1000000));
+
+  std::string line;
+  line.reserve(256);
+  line += "{\"ts\":\"";
+  line += ts;
+  line += "\",\"method\":";
+  append_json_string(line, rec.method, sizeof(rec.method));
+  line += ",\"route\":";
+  append_json_string(line, rec.route, sizeof(rec.route));
+  line += ",\"status\":" + std::to_string(rec.status);
+  line += ",\"latency_us\":" + std::to_string(rec.latency_us);
+  line += ",\"db_us\":" + std::to_string(rec.db_us);
+  line += ",\"bytes\":" + std::to_string(rec.bytes);
+  if (rec.user_id != 0) line += ",\"user_id\":" + std::to_string(rec.user_id);
+  line += "}\n";
+
+  std::fwrite(line.data(), 1, line.size(), file_);
+  file_bytes_ += line.size();
+  if (max_file_bytes_ > 0 && file_bytes_ >= max_file_bytes_) {
+    std::fflush(file_);
+    rotate();
+  }
+}
+
+} // namespace http
@@ -0,0 +1,75 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+
+// Асинхронный структурированный журнал доступа.
+//
+// Потоки запросов пишут записи фиксированного размера в кольцевой буфер без
+// блокировок (несколько производителей, один потребитель). Фоновый поток
+// форматирует их в JSON-строки и пишет в файл с ротацией. Если буфер полон,
+// запись отбрасывается — путь запроса никогда не ждёт диска.
+
+namespace http {
+
+struct AccessRecord {
+  uint64_t ts_us;       // время начала запроса, мкс с эпохи Unix
+  uint32_t latency_us;
+  uint32_t db_us;
+  uint32_t bytes;
+  int32_t user_id;      // 0 — анонимный
+  uint16_t status;
+  char method[8];
+  char route[94];       // шаблон маршрута (см. route_pattern), обрезается
+};
+static_assert(sizeof(AccessRecord) == 128, "AccessRecord should stay two cache lines");
+
+class AccessLog {
+public:
+  // capacity округляется вверх до степени двойки.
+  AccessLog(std::string path, size_t capacity, size_t max_file_bytes, int keep_files);
+  ~AccessLog();
+  AccessLog(const AccessLog&) = delete;
+  AccessLog& operator=(const AccessLog&) = delete;
+
+  // Не блокирует: false, если буфер полон и запись отброшена.
+  bool log(const AccessRecord& rec);
+
+  uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+  static void set_text(char* dst, size_t cap, const std::string& src);
+
+private:
+  struct Cell {
+    std::atomic<size_t> seq;
+    AccessRecord rec;
+  };
+
+  bool pop(AccessRecord& out);
+  void run();
+  void open_file();
+  void rotate();
+  void write_line(const AccessRecord& rec);
+
+  std::unique_ptr<Cell[]> cells_;
+  size_t mask_;
+  alignas(64) std::atomic<size_t> head_{0};  // позиция производителей
+  alignas(64) size_t tail_ = 0;              // позиция потребителя (только фоновый поток)
+  alignas(64) std::atomic<uint64_t> dropped_{0};
+
+  std::string path_;
+  size_t max_file_bytes_;
+  int keep_files_;
+  std::FILE* file_ = nullptr;
+  size_t file_bytes_ = 0;
+  uint64_t reported_dropped_ = 0;
+
+  std::atomic<bool> stop_{false};
+  std::thread worker_;
+};
+
+} // namespace http
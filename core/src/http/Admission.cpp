@@ -0,0 +1,202 @@
+#include "Admission.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <sstream>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+namespace http {
+
+namespace {
+
+constexpr size_t kMaxProbes = 16;
+// Бакет, не трогавшийся дольше этого, можно отдать другому ключу
+constexpr uint32_t kIdleReuseMs = 10 * 60 * 1000;
+
+uint64_t pack(uint32_t milli_tokens, uint32_t ms) { return (static_cast<uint64_t>(milli_tokens) << 32) | ms; }
+uint32_t tokens_of(uint64_t state) { return static_cast<uint32_t>(state >> 32); }
+uint32_t time_of(uint64_t state) { return static_cast<uint32_t>(state); }
+
+uint64_t mix(uint64_t x) {
+  x ^= x >> 33; x *= 0xff51afd7ed558ccdULL;
+  x ^= x >> 33; x *= 0xc4ceb9fe1a85ec53ULL;
+  x ^= x >> 33;
+  return x;
+}
+
+uint64_t bucket_key(char kind, RouteClass rc, const std::string& id) {
+  uint64_t h = std::hash<std::string>{}(id);
+  h = mix(h ^ (static_cast<uint64_t>(kind) << 56) ^ (static_cast<uint64_t>(rc) << 48));
+  return h ? h : 1;  // 0 зарезервирован под пустой слот
+}
+
+uint32_t now_ms() {
+  using namespace std::chrono;
+  return static_cast<uint32_t>(duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count());
+}
+
+void env_rate(const char* name, RateLimit& out) {
+  // Формат: "<rps>:<burst>", например RATE_USER_LOW=20:60
+  if (const char* v = std::getenv(name)) {
+    char* end = nullptr;
+    out.rate_per_sec = std::strtod(v, &end);
+    if (end && *end == ':') out.burst = std::strtod(end + 1, nullptr);
+  }
+}
+
+void env_int(const char* name, int& out) {
+  if (const char* v = std::getenv(name)) out = std::atoi(v);
+}
+
+} // namespace
+
+RouteClass classify_route(const std::string& method, const std::string& path) {
+  // Выгрузка попыток — самый долгий и тяжёлый маршрут: режется первой
+  if (path.find("/attempts/export") != std::string::npos) return RouteClass::Low;
+  // Сдача, автосохранение и проверка попыток важнее всего остального
+  if (path.find("/submit") != std::string::npos || path.find("/attempts") != std::string::npos ||
+      path.find("/grade") != std::string::npos) {
+    return RouteClass::Critical;
+  }
+  if (method == "GET" || method == "HEAD") return RouteClass::Low;
+  return RouteClass::Normal;
+}
+
+const char* route_class_name(RouteClass rc) {
+  switch (rc) {
+    case RouteClass::Critical: return "critical";
+    case RouteClass::Normal: return "normal";
+    default: return "low";
+  }
+}
+
+TokenBucketTable::TokenBucketTable(size_t capacity_pow2)
+  : slots_(new Slot[capacity_pow2]), mask_(capacity_pow2 - 1) {}
+
+TokenBucketTable::Slot* TokenBucketTable::slot_for(uint64_t key, uint32_t now, uint32_t initial_tokens) {
+  size_t idx = static_cast<size_t>(key) & mask_;
+  for (size_t probe = 0; probe < kMaxProbes; ++probe, idx = (idx + 1) & mask_) {
+    Slot& s = slots_[idx];
+    uint64_t k = s.key.load(std::memory_order_acquire);
+    if (k == key) return &s;
+    if (k == 0) {
+      uint64_t expected = 0;
+      if (s.key.compare_exchange_strong(expected, key, std::memory_order_acq_rel)) {
+        s.state.store(pack(initial_tokens, now), std::memory_order_release);
+        return &s;
+      }
+      if (expected == key) return &s;
+      continue;
+    }
+    // Занят давно простаивающим ключом — забираем слот себе
+    uint64_t st = s.state.load(std::memory_order_acquire);
+    if (now - time_of(st) > kIdleReuseMs && s.key.compare_exchange_strong(k, key, std::memory_order_acq_rel)) {
+      s.state.store(pack(initial_tokens, now), std::memory_order_release);
+      return &s;
+    }
+  }
+  return nullptr;
+}
+
+bool TokenBucketTable::try_acquire(uint64_t key, uint32_t now, double rate_per_sec, double burst,
+                                   uint32_t& retry_after_ms) {
+  const uint32_t cap = static_cast<uint32_t>(burst * 1000);
+  Slot* s = slot_for(key, now, cap);
+  if (!s) return true;  // таблица переполнена — лучше пропустить, чем отказать всем
+
+  uint64_t st = s->state.load(std::memory_order_acquire);
+  for (;;) {
+    uint32_t elapsed = now - time_of(st);
+    double refilled = tokens_of(st) + elapsed * rate_per_sec;  // милли-токены: rate/с == rate милли-токенов/мс
+    uint32_t tokens = refilled >= cap ? cap : static_cast<uint32_t>(refilled);
+    if (tokens < 1000) {
+      retry_after_ms = static_cast<uint32_t>(std::ceil((1000 - tokens) / rate_per_sec));
+      return false;
+    }
+    if (s->state.compare_exchange_weak(st, pack(tokens - 1000, now), std::memory_order_acq_rel)) return true;
+  }
+}
+
+AdmissionConfig AdmissionConfig::from_env() {
+  AdmissionConfig cfg;
+  env_rate("RATE_USER_CRITICAL", cfg.per_user[0]);
+  env_rate("RATE_USER_NORMAL", cfg.per_user[1]);
+  env_rate("RATE_USER_LOW", cfg.per_user[2]);
+  env_rate("RATE_IP_NORMAL", cfg.per_ip[1]);
+  env_rate("RATE_IP_LOW", cfg.per_ip[2]);
+  env_int("LISTEN_BACKLOG", cfg.backlog);
+  env_int("SHED_DEPTH_NORMAL", cfg.shed_depth[1]);
+  env_int("SHED_DEPTH_LOW", cfg.shed_depth[2]);
+  env_int("SHED_RETRY_AFTER", cfg.shed_retry_after_s);
+  if (const char* v = std::getenv("TRUSTED_PROXIES")) {
+    std::stringstream ss(v);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+      size_t slash = item.find('/');
+      int bits = slash == std::string::npos ? 32 : std::atoi(item.c_str() + slash + 1);
+      in_addr addr{};
+      if (inet_pton(AF_INET, item.substr(0, slash).c_str(), &addr) != 1 || bits < 0 || bits > 32) continue;
+      uint32_t mask = bits == 0 ? 0 : ~uint32_t{0} << (32 - bits);
+      cfg.trusted_proxies.emplace_back(ntohl(addr.s_addr) & mask, mask);
+    }
+  }
+  return cfg;
+}
+
+bool AdmissionConfig::trusts_proxy(const std::string& peer_ip) const {
+  in_addr addr{};
+  if (trusted_proxies.empty() || inet_pton(AF_INET, peer_ip.c_str(), &addr) != 1) return false;
+  uint32_t ip = ntohl(addr.s_addr);
+  for (const auto& net : trusted_proxies) {
+    if ((ip & net.second) == net.first) return true;
+  }
+  return false;
+}
+
+Admission::Admission(AdmissionConfig cfg) : cfg_(cfg), buckets_(1 << 14) {}
+
+AdmissionDecision Admission::check(RouteClass rc, int user_id, const std::string& ip, int queue_depth) {
+  AdmissionDecision d;
+  const int idx = static_cast<int>(rc);
+
+  // 1. Перегрузка: очередь accept растёт — отбрасываем низкие классы сразу, не тратя время на БД
+  if (cfg_.shed_depth[idx] > 0 && queue_depth >= cfg_.shed_depth[idx]) {
+    d.admit = false;
+    d.status = 503;
+    d.retry_after_s = cfg_.shed_retry_after_s;
+    d.reason = "OVERLOADED";
+    return d;
+  }
+
+  const uint32_t now = now_ms();
+  uint32_t wait_ms = 0;
+  auto limited = [&](char kind, const std::string& id, const RateLimit& lim) {
+    if (lim.rate_per_sec <= 0) return false;
+    if (buckets_.try_acquire(bucket_key(kind, rc, id), now, lim.rate_per_sec, lim.burst, wait_ms)) return false;
+    d.admit = false;
+    d.status = 429;
+    d.retry_after_s = static_cast<int>((wait_ms + 999) / 1000);
+    if (d.retry_after_s < 1) d.retry_after_s = 1;
+    d.reason = kind == 'u' ? "USER_RATE_LIMITED" : "IP_RATE_LIMITED";
+    return true;
+  };
+
+  // 2. Лимиты: сначала пользователь, потом IP
+  if (user_id != 0 && limited('u', std::to_string(user_id), cfg_.per_user[idx])) return d;
+  if (!ip.empty() && limited('i', ip, cfg_.per_ip[idx])) return d;
+  return d;
+}
+
+int Admission::accept_queue_depth(int listen_fd) {
+  // Для сокета в состоянии LISTEN Linux отдаёт в tcpi_unacked длину очереди accept
+  struct tcp_info info{};
+  socklen_t len = sizeof(info);
+  if (getsockopt(listen_fd, IPPROTO_TCP, TCP_INFO, &info, &len) != 0) return -1;
+  return static_cast<int>(info.tcpi_unacked);
+}
+
+} // namespace http
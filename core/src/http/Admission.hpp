@@ -0,0 +1,90 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Контроль допуска запросов перед маршрутизацией: токен-бакеты на пользователя
+// и на IP отдельно для каждого класса маршрутов плюс сброс нагрузки по глубине
+// очереди accept, чтобы шторм повторов каталога не вытеснял сдачу попыток.
+
+namespace http {
+
+// Класс маршрута; чем меньше значение, тем выше приоритет.
+enum class RouteClass { Critical = 0, Normal = 1, Low = 2 };
+constexpr size_t kRouteClassCount = 3;
+
+RouteClass classify_route(const std::string& method, const std::string& path);
+const char* route_class_name(RouteClass rc);
+
+// Таблица токен-бакетов фиксированного размера без блокировок.
+// Слот: ключ (0 — свободен) и упакованное состояние
+// [милли-токены : 32 | время последнего пополнения, мс : 32], меняемое через CAS.
+class TokenBucketTable {
+public:
+  explicit TokenBucketTable(size_t capacity_pow2);
+
+  // true — токен списан. Иначе в retry_after_ms — сколько ждать до следующего токена.
+  bool try_acquire(uint64_t key, uint32_t now_ms, double rate_per_sec, double burst, uint32_t& retry_after_ms);
+
+private:
+  struct Slot {
+    std::atomic<uint64_t> key{0};
+    std::atomic<uint64_t> state{0};
+  };
+  Slot* slot_for(uint64_t key, uint32_t now_ms, uint32_t initial_tokens);
+
+  std::unique_ptr<Slot[]> slots_;
+  size_t mask_;
+};
+
+struct RateLimit {
+  double rate_per_sec;
+  double burst;
+};
+
+struct AdmissionConfig {
+  // Лимиты по классам маршрутов (индекс — RouteClass)
+  RateLimit per_user[kRouteClassCount] = {{5, 20}, {10, 30}, {20, 60}};
+  // Лимит на IP не применяется к Critical: в аудитории много студентов за одним NAT
+  RateLimit per_ip[kRouteClassCount] = {{0, 0}, {50, 100}, {50, 100}};
+  int backlog = 128;
+  // Глубина очереди accept, при которой начинаем отбрасывать класс (0 — никогда)
+  int shed_depth[kRouteClassCount] = {0, 96, 32};
+  int shed_retry_after_s = 1;
+  // Прокси, которым верим в X-Real-IP (TRUSTED_PROXIES="10.0.0.5,172.16.0.0/12"):
+  // сеть и маска IPv4 в порядке байтов хоста. Пиры Unix-сокета доверенные всегда
+  std::vector<std::pair<uint32_t, uint32_t>> trusted_proxies;
+
+  bool trusts_proxy(const std::string& peer_ip) const;
+
+  static AdmissionConfig from_env();
+};
+
+struct AdmissionDecision {
+  bool admit = true;
+  int status = 200;          // 429 или 503 при отказе
+  int retry_after_s = 0;
+  const char* reason = "";
+};
+
+class Admission {
+public:
+  explicit Admission(AdmissionConfig cfg);
+
+  // user_id == 0 — анонимный запрос, ограничивается только по IP.
+  AdmissionDecision check(RouteClass rc, int user_id, const std::string& ip, int queue_depth);
+
+  const AdmissionConfig& config() const { return cfg_; }
+
+  // Текущая длина очереди accept у слушающего TCP-сокета (-1, если неизвестно).
+  static int accept_queue_depth(int listen_fd);
+
+private:
+  AdmissionConfig cfg_;
+  TokenBucketTable buckets_;
+};
+
+} // namespace http
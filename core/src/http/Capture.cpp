@@ -0,0 +1,133 @@
+#include "Capture.hpp"
+#include <chrono>
+#include <cctype>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+
+namespace http {
+
+namespace {
+
+uint64_t steady_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool is_secret_header(const std::string& name) {
+  static const char* const kSecret[] = {"authorization", "proxy-authorization", "cookie", "set-cookie", "x-api-key"};
+  std::string lower;
+  for (char c : name) lower += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+  for (const char* s : kSecret) {
+    if (lower == s) return true;
+  }
+  return false;
+}
+
+} // namespace
+
+uint32_t CaptureWriter::pseudonym(const char* value, size_t length) {
+  // FNV-1a по соли и значению: соль не покидает процесс, номер выдаётся по порядку
+  uint64_t h = 14695981039346656037ull;
+  auto mix = [&h](const unsigned char* p, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+      h ^= p[i];
+      h *= 1099511628211ull;
+    }
+  };
+  mix(reinterpret_cast<const unsigned char*>(salt_), sizeof(salt_));
+  mix(reinterpret_cast<const unsigned char*>(value), length);
+  auto it = pseudonyms_.emplace(h, static_cast<uint32_t>(pseudonyms_.size())).first;
+  return it->second;
+}
+
+std::string CaptureWriter::scrub(const std::string& request) {
+  size_t headers_end = request.find("\r\n\r\n");
+  if (headers_end == std::string::npos) headers_end = request.size();
+
+  std::string out;
+  out.reserve(request.size());
+  size_t pos = 0;
+  while (pos < headers_end) {
+    size_t eol = request.find("\r\n", pos);
+    if (eol == std::string::npos || eol > headers_end) eol = headers_end;
+    size_t colon = request.find(':', pos);
+    if (pos > 0 && colon < eol && is_secret_header(request.substr(pos, colon - pos))) {
+      char hex[9];
+      std::snprintf(hex, sizeof(hex), "%08x", pseudonym(request.data() + colon + 1, eol - colon - 1));
+      out.append(request, pos, colon - pos);
+      out += ": scrubbed-";
+      out += hex;
+    } else {
+      out.append(request, pos, eol - pos);
+    }
+    if (eol < headers_end) out += "\r\n";
+    pos = eol + 2;
+  }
+  out.append(request, headers_end, std::string::npos);
+  return out;
+}
+
+CaptureWriter::CaptureWriter(const std::string& path, size_t max_bytes)
+  : max_bytes_(max_bytes), buffer_(1 << 20) {
+  std::random_device rd;
+  for (auto& part : salt_) part = (static_cast<uint64_t>(rd()) << 32) | rd();
+  file_ = std::fopen(path.c_str(), "wb");
+  if (!file_) throw std::runtime_error("cannot open capture file " + path);
+  std::setvbuf(file_, buffer_.data(), _IOFBF, buffer_.size());
+
+  CaptureFileHeader header{};
+  std::memcpy(header.magic, kCaptureMagic, sizeof(header.magic));
+  header.version = kCaptureVersion;
+  header.started_unix_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::system_clock::now().time_since_epoch()).count();
+  std::fwrite(&header, sizeof(header), 1, file_);
+  written_ = sizeof(header);
+  started_steady_ns_ = steady_ns();
+}
+
+CaptureWriter::~CaptureWriter() {
+  if (file_) std::fclose(file_);
+}
+
+void CaptureWriter::record(const std::string& request) {
+  if (!file_) return;
+  std::string scrubbed = scrub(request);
+  if (written_ + sizeof(CaptureRecordHeader) + scrubbed.size() > max_bytes_) {
+    // Лимит размера: закрываем файл, дальше запросы не пишутся
+    std::cerr << "capture: size limit reached after " << records_ << " requests" << std::endl;
+    std::fclose(file_);
+    file_ = nullptr;
+    return;
+  }
+  CaptureRecordHeader rec{steady_ns() - started_steady_ns_, static_cast<uint32_t>(scrubbed.size()), 0};
+  std::fwrite(&rec, sizeof(rec), 1, file_);
+  std::fwrite(scrubbed.data(), 1, scrubbed.size(), file_);
+  written_ += sizeof(rec) + scrubbed.size();
+  // Раз в 256 записей сбрасываем буфер, чтобы файл был полезен и при аварийном завершении
+  if (++records_ % 256 == 0) std::fflush(file_);
+}
+
+std::vector<CapturedRequest> read_capture(const std::string& path) {
+  std::FILE* f = std::fopen(path.c_str(), "rb");
+  if (!f) throw std::runtime_error("cannot open capture file " + path);
+
+  std::vector<CapturedRequest> out;
+  CaptureFileHeader header{};
+  if (std::fread(&header, sizeof(header), 1, f) != 1 ||
+      std::memcmp(header.magic, kCaptureMagic, sizeof(header.magic)) != 0 || header.version != kCaptureVersion) {
+    std::fclose(f);
+    throw std::runtime_error("not a capture file: " + path);
+  }
+  CaptureRecordHeader rec{};
+  while (std::fread(&rec, sizeof(rec), 1, f) == 1) {
+    CapturedRequest r{rec.offset_ns, std::string(rec.length, '\0')};
+    // Обрезанный хвост (сервер остановлен во время записи) пропускаем
+    if (rec.length && std::fread(&r.bytes[0], 1, rec.length, f) != rec.length) break;
+    out.push_back(std::move(r));
+  }
+  std::fclose(f);
+  return out;
+}
+
+} // namespace http
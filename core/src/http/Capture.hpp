@@ -0,0 +1,77 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Запись входящего трафика для нагрузочного воспроизведения (core-replay).
+//
+// Формат файла (little-endian):
+//   CaptureFileHeader
+//   { CaptureRecordHeader; char bytes[length]; } ...
+// Запрос хранится как пришёл (строка запроса, заголовки, тело), только значения
+// Authorization/Cookie и подобных заменены на "scrubbed-<8 hex>" — порядковый номер
+// псевдонима: одинаковые значения получают один номер, и при воспроизведении
+// сохраняется распределение по пользователям. Соответствие номеров значениям живёт
+// только в памяти процесса (ключ — хеш с солью, случайной для каждой записи),
+// так что по файлу исходный токен не восстановить перебором.
+
+namespace http {
+
+constexpr char kCaptureMagic[4] = {'C', 'C', 'A', 'P'};
+constexpr uint16_t kCaptureVersion = 1;
+
+struct CaptureFileHeader {
+  char magic[4];
+  uint16_t version;
+  uint16_t reserved;
+  uint64_t started_unix_ns;  // время начала записи
+};
+
+struct CaptureRecordHeader {
+  uint64_t offset_ns;  // от начала записи (монотонные часы)
+  uint32_t length;
+  uint32_t reserved;
+};
+
+static_assert(sizeof(CaptureFileHeader) == 16, "capture header layout is part of the format");
+static_assert(sizeof(CaptureRecordHeader) == 16, "capture record layout is part of the format");
+
+// Запись идёт в поток запросов через буфер stdio; по достижении max_bytes запись прекращается.
+class CaptureWriter {
+public:
+  CaptureWriter(const std::string& path, size_t max_bytes);
+  ~CaptureWriter();
+  CaptureWriter(const CaptureWriter&) = delete;
+  CaptureWriter& operator=(const CaptureWriter&) = delete;
+
+  void record(const std::string& request);
+  uint64_t records() const { return records_; }
+
+  // Заменяет значения секретных заголовков на "scrubbed-<номер псевдонима>"
+  std::string scrub(const std::string& request);
+
+private:
+  uint32_t pseudonym(const char* value, size_t length);
+
+  std::FILE* file_ = nullptr;
+  size_t max_bytes_;
+  size_t written_ = 0;
+  uint64_t records_ = 0;
+  uint64_t started_steady_ns_ = 0;
+  std::vector<char> buffer_;
+  uint64_t salt_[2] = {0, 0};
+  std::unordered_map<uint64_t, uint32_t> pseudonyms_;  // хеш значения с солью -> номер
+};
+
+struct CapturedRequest {
+  uint64_t offset_ns;
+  std::string bytes;
+};
+
+// Читает файл целиком; бросает std::runtime_error, если он не читается или повреждён.
+std::vector<CapturedRequest> read_capture(const std::string& path);
+
+} // namespace http
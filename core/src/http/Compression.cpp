@@ -0,0 +1,158 @@
+#include "Compression.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <sstream>
+#include <stdexcept>
+
+namespace http {
+
+const char* encoding_name(Encoding enc) {
+  switch (enc) {
+    case Encoding::Gzip: return "gzip";
+    case Encoding::Deflate: return "deflate";
+    case Encoding::Zstd: return "zstd";
+    default: return "identity";
+  }
+}
+
+Encoding negotiate(const std::string& accept_encoding) {
+  double q_by_enc[kEncodingCount] = {0, 0, 0, 0};
+  bool listed[kEncodingCount] = {false, false, false, false};  // явное q=0 не перекрывается "*"
+  double q_any = -1;
+
+  std::stringstream ss(accept_encoding);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    std::string name = item.substr(0, item.find(';'));
+    name.erase(std::remove_if(name.begin(), name.end(), ::isspace), name.end());
+    std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+
+    double q = 1.0;
+    size_t qpos = item.find("q=");
+    if (qpos != std::string::npos) q = std::atof(item.c_str() + qpos + 2);
+
+    int enc = -1;
+    if (name == "gzip" || name == "x-gzip") enc = static_cast<int>(Encoding::Gzip);
+    else if (name == "deflate") enc = static_cast<int>(Encoding::Deflate);
+    else if (name == "zstd") enc = static_cast<int>(Encoding::Zstd);
+    else if (name == "*") q_any = q;
+    if (enc >= 0) {
+      q_by_enc[enc] = q;
+      listed[enc] = true;
+    }
+  }
+  if (q_any > 0) {
+    for (size_t i = 0; i < kEncodingCount; ++i) if (!listed[i]) q_by_enc[i] = q_any;
+  }
+
+#ifdef CORE_WITH_ZSTD
+  const Encoding preference[] = {Encoding::Zstd, Encoding::Gzip, Encoding::Deflate};
+#else
+  const Encoding preference[] = {Encoding::Gzip, Encoding::Deflate};
+#endif
+  Encoding best = Encoding::Identity;
+  double best_q = 0;
+  for (Encoding enc : preference) {
+    double q = q_by_enc[static_cast<int>(enc)];
+    if (q > best_q) { best = enc; best_q = q; }
+  }
+  return best;
+}
+
+Compressor::Compressor(int level) : level_(level) {
+  // 15 + 16 — gzip-обёртка, 15 — zlib-формат (HTTP "deflate")
+  if (deflateInit2(&gzip_, level_, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK ||
+      deflateInit2(&deflate_, level_, Z_DEFLATED, 15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+    throw std::runtime_error("zlib: deflateInit2 failed");
+  }
+#ifdef CORE_WITH_ZSTD
+  zstd_ = ZSTD_createCCtx();
+  if (!zstd_) throw std::runtime_error("zstd: ZSTD_createCCtx failed");
+#endif
+}
+
+Compressor::~Compressor() {
+  deflateEnd(&gzip_);
+  deflateEnd(&deflate_);
+#ifdef CORE_WITH_ZSTD
+  ZSTD_freeCCtx(zstd_);
+#endif
+}
+
+std::string Compressor::deflate_with(z_stream& zs, const std::string& in) {
+  deflateReset(&zs);
+  std::string out(deflateBound(&zs, static_cast<uLong>(in.size())), '\0');
+  zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in.data()));
+  zs.avail_in = static_cast<uInt>(in.size());
+  zs.next_out = reinterpret_cast<Bytef*>(&out[0]);
+  zs.avail_out = static_cast<uInt>(out.size());
+  if (deflate(&zs, Z_FINISH) != Z_STREAM_END) throw std::runtime_error("zlib: deflate failed");
+  out.resize(zs.total_out);
+  return out;
+}
+
+std::string Compressor::compress(Encoding enc, const std::string& in) {
+  switch (enc) {
+    case Encoding::Gzip: return deflate_with(gzip_, in);
+    case Encoding::Deflate: return deflate_with(deflate_, in);
+#ifdef CORE_WITH_ZSTD
+    case Encoding::Zstd: {
+      std::string out(ZSTD_compressBound(in.size()), '\0');
+      size_t n = ZSTD_compressCCtx(zstd_, &out[0], out.size(), in.data(), in.size(), ZSTD_CLEVEL_DEFAULT);
+      if (ZSTD_isError(n)) throw std::runtime_error(std::string("zstd: ") + ZSTD_getErrorName(n));
+      out.resize(n);
+      return out;
+    }
+#endif
+    default: return in;
+  }
+}
+
+size_t ResponseCache::footprint(const Entry& e) {
+  size_t total = e.raw.size();
+  for (const auto& v : e.encoded) total += v.size();
+  return total;
+}
+
+ResponseCache::Entry* ResponseCache::find(const std::string& key) {
+  auto it = slots_.find(key);
+  return it == slots_.end() ? nullptr : &it->second.entry;
+}
+
+ResponseCache::Entry& ResponseCache::put(const std::string& key, std::string raw) {
+  invalidate(key);
+  order_.push_back(key);
+  Slot& slot = slots_[key];
+  slot.entry.raw = std::move(raw);
+  slot.order = std::prev(order_.end());
+  bytes_ += slot.entry.raw.size();
+  evict();
+  return slot.entry;
+}
+
+const std::string& ResponseCache::encoded(Entry& entry, Encoding enc, Compressor& compressor) {
+  if (enc == Encoding::Identity) return entry.raw;
+  std::string& slot = entry.encoded[static_cast<int>(enc)];
+  if (slot.empty()) {
+    slot = compressor.compress(enc, entry.raw);
+    // Вытеснение — только в put(): на эту запись сейчас ссылается вызывающий
+    bytes_ += slot.size();
+  }
+  return slot;
+}
+
+void ResponseCache::invalidate(const std::string& key) {
+  auto it = slots_.find(key);
+  if (it == slots_.end()) return;
+  bytes_ -= footprint(it->second.entry);
+  order_.erase(it->second.order);
+  slots_.erase(it);
+}
+
+void ResponseCache::evict() {
+  // Самую свежую запись (последнюю в order_) оставляем всегда
+  while (bytes_ > max_bytes_ && order_.size() > 1) invalidate(order_.front());
+}
+
+} // namespace http
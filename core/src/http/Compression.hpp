@@ -0,0 +1,89 @@
+#pragma once
+#include <cstddef>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <zlib.h>
+#ifdef CORE_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+// Сжатие ответов: выбор кодировки по Accept-Encoding, переиспользуемые
+// контексты компрессоров и кэш уже сжатых тел для кэшируемых ответов.
+
+namespace http {
+
+enum class Encoding { Identity = 0, Gzip, Deflate, Zstd };
+constexpr size_t kEncodingCount = 4;
+
+const char* encoding_name(Encoding enc);
+
+// Разбирает Accept-Encoding с учётом q-значений. При равных q предпочитает
+// zstd (если собран), затем gzip, затем deflate.
+Encoding negotiate(const std::string& accept_encoding);
+
+// Компрессор с контекстами, которые живут между запросами
+// (deflateReset/ZSTD_compressCCtx вместо полной инициализации на каждый ответ).
+class Compressor {
+public:
+  explicit Compressor(int level);
+  ~Compressor();
+  Compressor(const Compressor&) = delete;
+  Compressor& operator=(const Compressor&) = delete;
+
+  std::string compress(Encoding enc, const std::string& in);
+
+private:
+  std::string deflate_with(z_stream& zs, const std::string& in);
+
+  int level_;
+  z_stream gzip_{};
+  z_stream deflate_{};
+#ifdef CORE_WITH_ZSTD
+  ZSTD_CCtx* zstd_ = nullptr;
+#endif
+};
+
+// Кэш тел кэшируемых ответов: рядом с исходным телом хранятся сжатые варианты,
+// чтобы горячий ответ сжимался один раз, а не на каждый запрос.
+// Ограничен по памяти, вытесняет самые старые записи.
+class ResponseCache {
+public:
+  struct Entry {
+    std::string raw;
+    std::string encoded[kEncodingCount];
+  };
+
+  explicit ResponseCache(size_t max_bytes) : max_bytes_(max_bytes) {}
+
+  Entry* find(const std::string& key);
+  Entry& put(const std::string& key, std::string raw);
+  // Сжатый вариант тела; сжимает и запоминает при первом обращении.
+  const std::string& encoded(Entry& entry, Encoding enc, Compressor& compressor);
+  void invalidate(const std::string& key);
+
+private:
+  struct Slot {
+    Entry entry;
+    std::list<std::string>::iterator order;
+  };
+  static size_t footprint(const Entry& e);
+  void evict();
+
+  size_t max_bytes_;
+  size_t bytes_ = 0;
+  std::unordered_map<std::string, Slot> slots_;
+  std::list<std::string> order_;  // от старых к новым
+};
+
+// Настройки и состояние сжатия, общие для всех запросов.
+struct Compression {
+  bool enabled = true;
+  size_t min_bytes = 1024;  // меньшие ответы отдаём как есть
+  Compressor compressor;
+  ResponseCache cache;
+
+  Compression(int level, size_t cache_bytes) : compressor(level), cache(cache_bytes) {}
+};
+
+} // namespace http
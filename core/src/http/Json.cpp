@@ -0,0 +1,156 @@
+#include "Json.hpp"
+#include <cctype>
+
+namespace http {
+
+namespace {
+
+void skip_ws(const std::string& s, size_t& i) {
+  while (i < s.size() && std::isspace(static_cast<unsigned char>(s[i]))) ++i;
+}
+
+// Конец значения, начинающегося в i (позиция после него); npos при ошибке
+size_t value_end(const std::string& s, size_t i) {
+  if (i >= s.size()) return std::string::npos;
+  if (s[i] == '"') {
+    for (size_t j = i + 1; j < s.size(); ++j) {
+      if (s[j] == '\\') ++j;
+      else if (s[j] == '"') return j + 1;
+    }
+    return std::string::npos;
+  }
+  if (s[i] == '{' || s[i] == '[') {
+    int depth = 0;
+    for (size_t j = i; j < s.size(); ++j) {
+      char c = s[j];
+      if (c == '"') {
+        size_t end = value_end(s, j);
+        if (end == std::string::npos) return end;
+        j = end - 1;
+      } else if (c == '{' || c == '[') {
+        ++depth;
+      } else if (c == '}' || c == ']') {
+        if (--depth == 0) return j + 1;
+      }
+    }
+    return std::string::npos;
+  }
+  size_t j = i;
+  while (j < s.size() && s[j] != ',' && s[j] != '}' && s[j] != ']' && !std::isspace(static_cast<unsigned char>(s[j]))) ++j;
+  return j;
+}
+
+} // namespace
+
+std::map<std::string, std::string> json_object_fields(const std::string& obj) {
+  std::map<std::string, std::string> out;
+  size_t i = 0;
+  skip_ws(obj, i);
+  if (i >= obj.size() || obj[i] != '{') return out;
+  ++i;
+  for (;;) {
+    skip_ws(obj, i);
+    if (i < obj.size() && obj[i] == '}') return out;
+    size_t key_end = value_end(obj, i);
+    if (key_end == std::string::npos || obj[i] != '"') return {};
+    auto key = json_unquote(obj.substr(i, key_end - i));
+    i = key_end;
+    skip_ws(obj, i);
+    if (i >= obj.size() || obj[i] != ':' || !key) return {};
+    ++i;
+    skip_ws(obj, i);
+    size_t end = value_end(obj, i);
+    if (end == std::string::npos || end == i) return {};
+    out[*key] = obj.substr(i, end - i);
+    i = end;
+    skip_ws(obj, i);
+    if (i < obj.size() && obj[i] == ',') { ++i; continue; }
+    if (i < obj.size() && obj[i] == '}') return out;
+    return {};
+  }
+}
+
+std::vector<std::string> json_array_items(const std::string& arr) {
+  std::vector<std::string> out;
+  size_t i = 0;
+  skip_ws(arr, i);
+  if (i >= arr.size() || arr[i] != '[') return out;
+  ++i;
+  for (;;) {
+    skip_ws(arr, i);
+    if (i < arr.size() && arr[i] == ']') return out;
+    size_t end = value_end(arr, i);
+    if (end == std::string::npos || end == i) return {};
+    out.push_back(arr.substr(i, end - i));
+    i = end;
+    skip_ws(arr, i);
+    if (i < arr.size() && arr[i] == ',') { ++i; continue; }
+    if (i < arr.size() && arr[i] == ']') return out;
+    return {};
+  }
+}
+
+std::optional<std::string> json_unquote(const std::string& raw) {
+  if (raw.size() < 2 || raw.front() != '"' || raw.back() != '"') return std::nullopt;
+  std::string out;
+  out.reserve(raw.size() - 2);
+  for (size_t i = 1; i + 1 < raw.size(); ++i) {
+    char c = raw[i];
+    if (c != '\\') { out += c; continue; }
+    if (i + 2 >= raw.size()) return std::nullopt;  // обратный слэш перед закрывающей кавычкой
+    switch (raw[++i]) {
+      case 'n': out += '\n'; break;
+      case 't': out += '\t'; break;
+      case 'r': out += '\r'; break;
+      case 'b': out += '\b'; break;
+      case 'f': out += '\f'; break;
+      case 'u': {
+        // \uXXXX -> UTF-8 (суррогатные пары не склеиваем)
+        if (i + 5 >= raw.size()) return std::nullopt;
+        unsigned cp = 0;
+        for (size_t k = 1; k <= 4; ++k) {
+          char h = raw[i + k];
+          if (!std::isxdigit(static_cast<unsigned char>(h))) return std::nullopt;
+          cp = cp * 16 + (std::isdigit(static_cast<unsigned char>(h)) ? h - '0' : (std::tolower(h) - 'a' + 10));
+        }
+        i += 4;
+        if (cp < 0x80) out += static_cast<char>(cp);
+        else if (cp < 0x800) { out += static_cast<char>(0xC0 | (cp >> 6)); out += static_cast<char>(0x80 | (cp & 0x3F)); }
+        else {
+          out += static_cast<char>(0xE0 | (cp >> 12));
+          out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+          out += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+        break;
+      }
+      default: out += raw[i]; break;  // \" \\ \/
+    }
+  }
+  return out;
+}
+
+std::string json_escape(const std::string& s) {
+  std::string out;
+  out.reserve(s.size());
+  for (char c : s) {
+    switch (c) {
+      case '"': out += "\\\""; break;
+      case '\\': out += "\\\\"; break;
+      case '\n': out += "\\n"; break;
+      case '\r': out += "\\r"; break;
+      case '\t': out += "\\t"; break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          static const char hex[] = "0123456789abcdef";
+          out += "\\u00";
+          out += hex[(c >> 4) & 0xF];
+          out += hex[c & 0xF];
+        } else {
+          out += c;
+        }
+    }
+  }
+  return out;
+}
+
+} // namespace http
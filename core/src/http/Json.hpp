@@ -0,0 +1,25 @@
+#pragma once
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Минимальный разбор JSON без внешних библиотек — только то, что нужно для
+// вложенных тел (пакетные запросы): значения возвращаются сырым текстом и
+// разбираются дальше по месту. Некорректный ввод даёт пустой результат.
+
+namespace http {
+
+// Поля верхнего уровня объекта: ключ -> сырой текст значения ("\"abc\"", "42", "{...}")
+std::map<std::string, std::string> json_object_fields(const std::string& obj);
+
+// Элементы верхнего уровня массива сырым текстом
+std::vector<std::string> json_array_items(const std::string& arr);
+
+// Строковое значение без кавычек и с раскрытыми escape-последовательностями
+std::optional<std::string> json_unquote(const std::string& raw);
+
+// Экранирование строки для вставки в JSON (без внешних кавычек)
+std::string json_escape(const std::string& s);
+
+} // namespace http
@@ -0,0 +1,150 @@
+#include "Listener.hpp"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace http {
+
+std::vector<ListenSpec> parse_listen_specs(const std::string& spec, mode_t unix_mode) {
+  std::vector<ListenSpec> out;
+  std::stringstream ss(spec);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    if (item.empty()) continue;
+    ListenSpec ls;
+    if (item.rfind("unix:", 0) == 0) {
+      ls.kind = ListenSpec::Kind::Unix;
+      ls.path = item.substr(5);
+      ls.mode = unix_mode;
+      if (ls.path.empty() || ls.path.size() >= sizeof(sockaddr_un::sun_path)) {
+        throw std::invalid_argument("bad unix socket path: " + item);
+      }
+    } else {
+      std::string addr = item.rfind("tcp:", 0) == 0 ? item.substr(4) : item;
+      size_t colon = addr.rfind(':');
+      try {
+        if (colon == std::string::npos) {
+          ls.port = std::stoi(addr);
+        } else {
+          if (colon > 0) ls.host = addr.substr(0, colon);
+          ls.port = std::stoi(addr.substr(colon + 1));
+        }
+      } catch (...) {
+        throw std::invalid_argument("bad tcp listen address: " + item);
+      }
+    }
+    out.push_back(ls);
+  }
+  if (out.empty()) throw std::invalid_argument("no listeners configured");
+  return out;
+}
+
+ListenerSet::~ListenerSet() {
+  for (const auto& l : listeners_) {
+    close(l.fd);
+    if (l.spec.kind == ListenSpec::Kind::Unix) unlink(l.spec.path.c_str());
+  }
+}
+
+void ListenerSet::open(const ListenSpec& spec, int backlog) {
+  int fd = -1;
+  if (spec.kind == ListenSpec::Kind::Tcp) {
+    fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) throw std::runtime_error(std::string("socket: ") + std::strerror(errno));
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(spec.port));
+    if (inet_pton(AF_INET, spec.host.c_str(), &addr.sin_addr) != 1) {
+      close(fd);
+      throw std::runtime_error("bad listen host: " + spec.host);
+    }
+    if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+      int err = errno;
+      close(fd);
+      throw std::runtime_error("bind " + spec.host + ":" + std::to_string(spec.port) + ": " + std::strerror(err));
+    }
+  } else {
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) throw std::runtime_error(std::string("socket: ") + std::strerror(errno));
+
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, spec.path.c_str(), sizeof(addr.sun_path) - 1);
+    // Сокет мог остаться от прошлого запуска; удаляем только сокет — опечатка в LISTEN
+    // не должна стирать обычный файл
+    struct stat st{};
+    if (lstat(spec.path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) unlink(spec.path.c_str());
+    // Права выставляем через umask на время bind: сокет сразу создаётся с нужным режимом,
+    // без окна между bind и chmod, когда к нему мог подключиться кто угодно
+    mode_t old_mask = umask(~spec.mode & 0777);
+    int rc = bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    int bind_err = errno;
+    umask(old_mask);
+    if (rc < 0) {
+      close(fd);
+      throw std::runtime_error("bind " + spec.path + ": " + std::strerror(bind_err));
+    }
+    // chmod оставляем: режим не должен зависеть от того, как ядро применяет umask к сокетам
+    if (chmod(spec.path.c_str(), spec.mode) < 0) {
+      int err = errno;
+      close(fd);
+      throw std::runtime_error("chmod " + spec.path + ": " + std::strerror(err));
+    }
+  }
+  if (listen(fd, backlog) < 0) {
+    int err = errno;
+    close(fd);
+    throw std::runtime_error(std::string("listen: ") + std::strerror(err));
+  }
+  listeners_.push_back({fd, spec});
+}
+
+bool ListenerSet::accept_next(int timeout_ms, AcceptedClient& out) {
+  std::vector<pollfd> fds(listeners_.size());
+  for (size_t i = 0; i < listeners_.size(); ++i) fds[i] = {listeners_[i].fd, POLLIN, 0};
+  int ready = poll(fds.data(), fds.size(), timeout_ms);
+  if (ready <= 0) {
+    if (ready < 0 && errno != EINTR) perror("poll");
+    return false;
+  }
+
+  for (size_t k = 0; k < listeners_.size(); ++k) {
+    size_t i = (next_ + k) % listeners_.size();
+    if (!(fds[i].revents & POLLIN)) continue;
+    next_ = i + 1;
+
+    const Entry& l = listeners_[i];
+    sockaddr_storage peer{};
+    socklen_t len = sizeof(peer);
+    int fd = accept4(l.fd, reinterpret_cast<sockaddr*>(&peer), &len, SOCK_CLOEXEC);
+    if (fd < 0) {
+      perror("accept");
+      return false;
+    }
+    out.fd = fd;
+    out.listener_fd = l.fd;
+    out.tcp = l.spec.kind == ListenSpec::Kind::Tcp;
+    out.peer_ip.clear();
+    if (peer.ss_family == AF_INET) {
+      char buf[INET_ADDRSTRLEN] = {0};
+      inet_ntop(AF_INET, &reinterpret_cast<sockaddr_in*>(&peer)->sin_addr, buf, sizeof(buf));
+      out.peer_ip = buf;
+    }
+    return true;
+  }
+  return false;
+}
+
+} // namespace http
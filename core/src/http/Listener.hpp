@@ -0,0 +1,55 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+// Слушающие сокеты core-api: TCP и Unix domain, сразу несколько.
+// Unix-сокет нужен, когда nginx живёт на том же хосте: без TCP/loopback
+// и без расхода эфемерных портов между прокси и сервисом.
+
+namespace http {
+
+struct ListenSpec {
+  enum class Kind { Tcp, Unix } kind = Kind::Tcp;
+  std::string host = "0.0.0.0";
+  int port = 0;
+  std::string path;     // для Unix
+  mode_t mode = 0660;   // права на файл Unix-сокета
+};
+
+// "tcp:0.0.0.0:8082,unix:/run/core/core.sock" -> список; бросает std::invalid_argument.
+std::vector<ListenSpec> parse_listen_specs(const std::string& spec, mode_t unix_mode);
+
+struct AcceptedClient {
+  int fd = -1;
+  int listener_fd = -1;
+  bool tcp = false;
+  std::string peer_ip;  // пусто для Unix-сокета
+};
+
+class ListenerSet {
+public:
+  ListenerSet() = default;
+  ~ListenerSet();
+  ListenerSet(const ListenerSet&) = delete;
+  ListenerSet& operator=(const ListenerSet&) = delete;
+
+  // Бросает std::runtime_error, если не удалось открыть сокет.
+  void open(const ListenSpec& spec, int backlog);
+
+  // Ждёт клиента на любом из сокетов не дольше timeout_ms (-1 — бесконечно).
+  // false — таймаут или ошибка accept.
+  bool accept_next(int timeout_ms, AcceptedClient& out);
+
+  size_t size() const { return listeners_.size(); }
+
+private:
+  struct Entry {
+    int fd;
+    ListenSpec spec;
+  };
+  std::vector<Entry> listeners_;
+  size_t next_ = 0;  // с какого сокета начинать обход, чтобы не голодал ни один
+};
+
+} // namespace http
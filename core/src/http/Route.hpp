@@ -0,0 +1,31 @@
+#pragma once
+#include <string>
+
+namespace http {
+
+// Шаблон маршрута для агрегации: числовые сегменты пути заменяются на {id},
+// строка запроса отбрасывается ("/tests/42/questions?x=1" -> "/tests/{id}/questions").
+inline std::string route_pattern(const std::string& path) {
+  std::string out;
+  out.reserve(path.size());
+  size_t i = 0;
+  const size_t end = path.find('?') == std::string::npos ? path.size() : path.find('?');
+  while (i < end) {
+    if (path[i] == '/') {
+      out += '/';
+      size_t j = i + 1;
+      while (j < end && path[j] >= '0' && path[j] <= '9') ++j;
+      if (j > i + 1 && (j == end || path[j] == '/')) {
+        out += "{id}";
+        i = j;
+        continue;
+      }
+      ++i;
+      continue;
+    }
+    out += path[i++];
+  }
+  return out.empty() ? "/" : out;
+}
+
+} // namespace http
@@ -6,9 +6,17 @@
 #include <vector>
 #include <unistd.h>
 #include <sys/socket.h>
-#include <netinet/in.h>
+#include <sys/time.h>
+#include <poll.h>
 #include <pqxx/pqxx>
 #include <optional>
+#include <cctype>
+#include <csignal>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <algorithm>
+#include <cerrno>
 
 #include "database/Database.hpp"
 #include "models/Test.hpp"
@@ -17,13 +25,68 @@
 #include "services/TestService.hpp"
 #include "services/QuestionService.hpp"
 #include "services/AnswerService.hpp"
+#include "services/SnapshotService.hpp"
+#include "services/BatchService.hpp"
+#include "services/AttemptExpiryService.hpp"
+#include "services/ExportService.hpp"
+#include "search/SearchIndex.hpp"
+#include "http/Compression.hpp"
+#include "http/Admission.hpp"
+#include "http/Json.hpp"
+#include "http/AccessLog.hpp"
+#include "http/Capture.hpp"
+#include "http/Route.hpp"
+#include "http/Listener.hpp"
+#include "trace/Trace.hpp"
 
-// Чтение HTTP-запроса
-std::string read_http_request(int client_socket) {
-    char buffer[4096] = {0};
-    ssize_t valread = read(client_socket, buffer, 4096);
-    if (valread > 0) return std::string(buffer, valread);
-    return "";
+// Чтение HTTP-запроса: заголовки и тело целиком по Content-Length (пакетные тела
+// не влезают в один read). Весь запрос должен прийти за timeout_ms, иначе клиент,
+// недославший тело, держал бы однопоточный сервер. Пустая строка — запрос не дочитан;
+// too_large — запрос больше max_bytes (тело не читается).
+std::string read_http_request(int client_socket, size_t max_bytes, int timeout_ms, bool& too_large) {
+    std::string request;
+    char buffer[4096];
+    size_t expected = std::string::npos;
+    too_large = false;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    for (;;) {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+        pollfd pfd{client_socket, POLLIN, 0};
+        if (left <= 0 || poll(&pfd, 1, static_cast<int>(left)) <= 0) return "";
+        ssize_t valread = read(client_socket, buffer, sizeof(buffer));
+        if (valread <= 0) return "";
+        request.append(buffer, valread);
+        if (expected == std::string::npos) {
+            size_t header_end = request.find("\r\n\r\n");
+            if (header_end == std::string::npos) {
+                if (request.size() >= max_bytes) { too_large = true; return ""; }
+                continue;
+            }
+            size_t content_length = 0;
+            size_t pos = request.find("\r\nContent-Length:");
+            if (pos == std::string::npos) pos = request.find("\r\ncontent-length:");
+            if (pos != std::string::npos && pos < header_end) content_length = std::strtoul(request.c_str() + pos + 17, nullptr, 10);
+            expected = header_end + 4 + content_length;
+            if (expected > max_bytes) { too_large = true; return ""; }
+        }
+        if (request.size() >= expected) break;
+    }
+    return request;
+}
+
+// Отправка ответа целиком: send может записать часть буфера (большие ответы) или
+// прерваться сигналом. Каждый вызов ограничен SO_SNDTIMEO сокета; MSG_NOSIGNAL —
+// закрывший соединение клиент даёт EPIPE, а не SIGPIPE, убивающий процесс.
+// false — клиент ушёл или не читает ответ.
+bool send_all(int client_socket, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = send(client_socket, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        sent += static_cast<size_t>(n);
+    }
+    return true;
 }
 
 // Парсинг первой строки запроса
@@ -39,7 +102,10 @@ std::map<std::string, std::string> parse_request(const std::string& request) {
     std::string method, path, http_version;
     request_line >> method >> path >> http_version;
     parsed["method"] = method;
-    parsed["path"] = path;
+    // Строку запроса отделяем от пути: маршруты сравнивают path целиком
+    size_t query_start = path.find('?');
+    parsed["path"] = path.substr(0, query_start);
+    parsed["query"] = query_start == std::string::npos ? "" : path.substr(query_start + 1);
 
     // Заголовки: читаем до пустой строки
     while (std::getline(ss, line)) {
@@ -64,30 +130,137 @@ std::map<std::string, std::string> parse_request(const std::string& request) {
 }
 
 
+// Декодирование %XX и '+' из строки запроса
+std::string url_decode(const std::string& s) {
+    std::string out;
+    out.reserve(s.size());
+    for (size_t i = 0; i < s.size(); ++i) {
+        if (s[i] == '+') out += ' ';
+        else if (s[i] == '%' && i + 2 < s.size() && std::isxdigit(static_cast<unsigned char>(s[i + 1])) &&
+                 std::isxdigit(static_cast<unsigned char>(s[i + 2]))) {
+            out += static_cast<char>(std::stoi(s.substr(i + 1, 2), nullptr, 16));
+            i += 2;
+        }
+        else out += s[i];
+    }
+    return out;
+}
+
+// Параметр строки запроса (декодированный), nullopt — если его нет
+std::optional<std::string> query_param(const std::map<std::string, std::string>& request_data, const std::string& name) {
+    auto it = request_data.find("query");
+    if (it == request_data.end()) return std::nullopt;
+    std::stringstream ss(it->second);
+    std::string pair;
+    while (std::getline(ss, pair, '&')) {
+        size_t eq = pair.find('=');
+        if (url_decode(pair.substr(0, eq)) != name) continue;
+        return eq == std::string::npos ? "" : url_decode(pair.substr(eq + 1));
+    }
+    return std::nullopt;
+}
+
+// Значение заголовка без учёта регистра имени ("" если заголовка нет)
+std::string header_value(const std::map<std::string, std::string>& request_data, const std::string& name) {
+    for (const auto& kv : request_data) {
+        if (kv.first.size() != name.size() + 4 || kv.first.compare(0, 4, "hdr:") != 0) continue;
+        bool same = true;
+        for (size_t i = 0; i < name.size() && same; ++i)
+            same = std::tolower(static_cast<unsigned char>(kv.first[i + 4])) == std::tolower(static_cast<unsigned char>(name[i]));
+        if (same) return kv.second;
+    }
+    return "";
+}
+
+// user_id из "Authorization: Bearer <user_id>" (временная схема для тестирования), 0 — нет
+int user_id_from_auth(const std::map<std::string, std::string>& request_data) {
+    std::string auth_header = header_value(request_data, "Authorization");
+    size_t pos = auth_header.find(" ");
+    if (pos == std::string::npos) return 0;
+    try { return std::stoi(auth_header.substr(pos + 1)); } catch (...) { return 0; }
+}
+
+// Строка статуса для кодов, которые возвращают сервисы
+std::string status_line_for(int status) {
+    switch (status) {
+        case 200: return "HTTP/1.1 200 OK";
+        case 201: return "HTTP/1.1 201 Created";
+        case 400: return "HTTP/1.1 400 Bad Request";
+        case 404: return "HTTP/1.1 404 Not Found";
+        case 409: return "HTTP/1.1 409 Conflict";
+        case 413: return "HTTP/1.1 413 Payload Too Large";
+        default: return "HTTP/1.1 500 Internal Server Error";
+    }
+}
+
 // Вспомогательная функция для извлечения ID из пути
 std::optional<int> extract_id_from_path(const std::string& path, const std::string& prefix) {
     if (path.rfind(prefix, 0) == 0 && path.length() > prefix.length()) {
         std::string id_str = path.substr(prefix.length());
+        // Только число целиком: иначе "/tests/5/questions" перехватывался бы как "/tests/5"
+        if (id_str.find_first_not_of("0123456789") != std::string::npos) return std::nullopt;
         try { return std::stoi(id_str); } catch (...) { return std::nullopt; }
     }
     return std::nullopt;
 }
 
+// ID из пути вида prefix + "{id}" + suffix
+std::optional<int> extract_id_between(const std::string& path, const std::string& prefix, const std::string& suffix) {
+    if (path.size() <= prefix.size() + suffix.size()) return std::nullopt;
+    if (path.compare(path.size() - suffix.size(), suffix.size(), suffix) != 0) return std::nullopt;
+    return extract_id_from_path(path.substr(0, path.size() - suffix.size()), prefix);
+}
+
+// Тело проверки: {"answers":{"<question_id>":[<answer_id>,...],...}}
+std::map<int, std::vector<int>> parse_selected_answers(const std::string& body) {
+    std::map<int, std::vector<int>> selected;
+    size_t pos = body.find("\"answers\"");
+    if (pos == std::string::npos) return selected;
+    pos = body.find('{', pos);
+    while (pos != std::string::npos) {
+        size_t q1 = body.find('"', pos + 1);
+        size_t close = body.find('}', pos + 1);
+        if (q1 == std::string::npos || (close != std::string::npos && close < q1)) break;
+        size_t q2 = body.find('"', q1 + 1);
+        size_t open = body.find('[', q2);
+        size_t end = body.find(']', open);
+        if (q2 == std::string::npos || open == std::string::npos || end == std::string::npos) break;
+        try {
+            int qid = std::stoi(body.substr(q1 + 1, q2 - q1 - 1));
+            std::vector<int>& ids = selected[qid];
+            std::stringstream list(body.substr(open + 1, end - open - 1));
+            std::string item;
+            while (std::getline(list, item, ',')) {
+                if (item.find_first_of("0123456789") != std::string::npos) ids.push_back(std::stoi(item));
+            }
+        } catch (...) {}
+        pos = end;
+    }
+    return selected;
+}
+
 // Обработка запроса
-std::string handle_request(const std::string& full_request,
+std::string handle_request(const std::map<std::string, std::string>& request_data,
                            TestService& testService,
                            QuestionService& questionService,
                            AnswerService& answerService,
+                           SnapshotService& snapshotService,
+                           BatchService& batchService,
+                           AttemptExpiryService& expiryService,
+                           SearchIndex& searchIndex,
+                           http::Compression& compression,
                            Database& db) {
-    auto request_data = parse_request(full_request);
+    std::optional<trace::Span> route_span(std::in_place, "handle_request", "route");
     const std::string& path = request_data.at("path");
     const std::string& method = request_data.at("method");
     std::string response_body;
     std::string status_line;
+    http::ResponseCache::Entry* cached = nullptr;  // тело из кэша ответов (вместе со сжатыми вариантами)
 
     // ---------- TESTS ----------
     if (method == "GET" && path == "/tests") {
         auto tests = testService.list();
+        trace::Span json_span("json");
         std::stringstream ss;
         ss << "[";
         bool first = true;
@@ -100,6 +273,59 @@ std::string handle_request(const std::string& full_request,
         status_line = "HTTP/1.1 200 OK";
         response_body = ss.str();
     }
+    // ---------- SNAPSHOTS ----------
+    else if (method == "POST" && extract_id_between(path, "/tests/", "/snapshot")) {
+        int test_id = extract_id_between(path, "/tests/", "/snapshot").value();
+        try {
+            SnapshotService::CompileStatus compile_status;
+            const auto* snap = snapshotService.compile(test_id, compile_status);
+            if (snap) {
+                status_line = "HTTP/1.1 201 Created";
+                response_body = "{\"test_id\":" + std::to_string(test_id) +
+                                ",\"version\":" + std::to_string(snapshot::kVersion) +
+                                ",\"questions\":" + std::to_string(snap->question_count()) +
+                                ",\"bytes\":" + std::to_string(snap->size()) + "}";
+            } else if (compile_status == SnapshotService::CompileStatus::NotPublished) {
+                status_line = "HTTP/1.1 409 Conflict";
+                response_body = "{\"code\":\"NOT_PUBLISHED\",\"message\":\"Only published tests can be compiled\"}";
+            } else {
+                status_line = "HTTP/1.1 404 Not Found";
+                response_body = "{\"message\":\"Test not found\"}";
+            }
+        } catch (const std::exception& e) {
+            status_line = "HTTP/1.1 500 Internal Server Error";
+            response_body = std::string("{\"code\":\"SNAPSHOT_ERROR\",\"message\":\"") + http::json_escape(e.what()) + "\"}";
+        }
+    }
+    else if (method == "GET" && extract_id_between(path, "/tests/", "/snapshot")) {
+        int test_id = extract_id_between(path, "/tests/", "/snapshot").value();
+        const auto* snap = snapshotService.find(test_id);
+        if (snap) {
+            // Снимок неизменяем до перекомпиляции — JSON и его сжатые варианты кэшируем.
+            // Ключ из разобранного id, как при инвалидации: "/tests/05/snapshot" — тот же снимок
+            const std::string cache_key = "/tests/" + std::to_string(test_id) + "/snapshot";
+            cached = compression.cache.find(cache_key);
+            if (!cached) {
+                trace::Span json_span("snapshot_to_json", "json");
+                cached = &compression.cache.put(cache_key, snap->to_json());
+            }
+            status_line = "HTTP/1.1 200 OK";
+        }
+        else { status_line = "HTTP/1.1 404 Not Found"; response_body = "{\"message\":\"Snapshot not found\"}"; }
+    }
+    else if (method == "POST" && extract_id_between(path, "/tests/", "/grade")) {
+        const auto* snap = snapshotService.find(extract_id_between(path, "/tests/", "/grade").value());
+        if (snap) {
+            std::string body = request_data.count("body") ? request_data.at("body") : "";
+            uint32_t score = 0;
+            for (const auto& entry : parse_selected_answers(body)) score += snap->grade(entry.first, entry.second);
+            status_line = "HTTP/1.1 200 OK";
+            response_body = "{\"score\":" + std::to_string(score) + ",\"max_score\":" + std::to_string(snap->max_score()) + "}";
+        } else {
+            status_line = "HTTP/1.1 404 Not Found";
+            response_body = "{\"message\":\"Snapshot not found\"}";
+        }
+    }
     else if (method == "GET" && extract_id_from_path(path, "/tests/")) {
         int test_id = extract_id_from_path(path, "/tests/").value();
         auto test = testService.get(test_id);
@@ -142,14 +368,46 @@ std::string handle_request(const std::string& full_request,
     else if (method == "DELETE" && extract_id_from_path(path, "/tests/")) {
         int test_id = extract_id_from_path(path, "/tests/").value();
         bool ok = testService.remove(test_id);
+        // Удалённый тест не должен отдаваться и проверяться по старому снимку
+        if (ok) snapshotService.remove(test_id);
         if (ok) { status_line = "HTTP/1.1 200 OK"; response_body = "{\"message\":\"Test deleted\"}"; }
         else { status_line = "HTTP/1.1 404 Not Found"; response_body = "{\"message\":\"Test not found\"}"; }
     }
 
+    // ---------- SEARCH: GET /questions/search?q=...&limit=N ----------
+    else if (method == "GET" && path == "/questions/search") {
+        std::string q = query_param(request_data, "q").value_or("");
+        size_t limit = 20;
+        if (auto l = query_param(request_data, "limit")) {
+            try { limit = std::min<size_t>(std::max(1, std::stoi(*l)), 100); } catch (...) {}
+        }
+        bool too_short = false;
+        std::vector<SearchIndex::Hit> hits;
+        {
+            trace::Span search_span("search", "search");
+            hits = searchIndex.search(q, limit, too_short);
+        }
+        if (too_short) {
+            status_line = "HTTP/1.1 400 Bad Request";
+            response_body = "{\"code\":\"QUERY_TOO_SHORT\",\"message\":\"Query needs a word of at least 3 characters\"}";
+        } else {
+            std::stringstream ss;
+            ss << "{\"results\":[";
+            for (size_t i = 0; i < hits.size(); ++i) {
+                if (i) ss << ",";
+                ss << "{\"score\":" << hits[i].score << ",\"question\":" << questionToJson(*hits[i].question) << "}";
+            }
+            ss << "]}";
+            status_line = "HTTP/1.1 200 OK";
+            response_body = ss.str();
+        }
+    }
+
     // ---------- QUESTIONS ----------
     else if (method == "GET" && path.find("/tests/") == 0 && path.find("/questions") != std::string::npos) {
         int test_id = std::stoi(path.substr(7, path.find("/questions") - 7));
         auto questions = questionService.list_by_test(test_id);
+        trace::Span json_span("json");
         std::stringstream ss;
         ss << "[";
         bool first = true;
@@ -202,6 +460,7 @@ std::string handle_request(const std::string& full_request,
     else if (method == "GET" && path.find("/questions/") == 0 && path.find("/answers") != std::string::npos) {
         int qid = std::stoi(path.substr(11, path.find("/answers") - 11));
         auto answers = answerService.list_by_question(qid);
+        trace::Span json_span("json");
         std::stringstream ss;
         ss << "[";
         bool first = true;
@@ -245,6 +504,26 @@ std::string handle_request(const std::string& full_request,
         response_body = ok ? "{\"message\":\"Answer deleted\"}" : "{\"message\":\"Answer not found\"}";
     }
 
+    // ---------- BATCH ----------
+    else if (method == "POST" && path == "/batch") {
+        auto result = batchService.execute(request_data.count("body") ? request_data.at("body") : "");
+        status_line = status_line_for(result.status);
+        response_body = result.body;
+    }
+
+    // ---------- EXPORT: GET /tests/{id}/attempts/export ----------
+    // Допустимые запросы выгрузки (и отказ по лимиту выгрузок) обслуживает цикл сервера;
+    // сюда попадают только запросы без авторизации или с неверным форматом
+    else if (method == "GET" && extract_id_between(path, "/tests/", "/attempts/export")) {
+        if (user_id_from_auth(request_data) == 0) {
+            status_line = "HTTP/1.1 401 Unauthorized";
+            response_body = "{\"code\":\"UNAUTHORIZED\",\"message\":\"Missing or invalid Authorization header (use 'Bearer <user_id>' for now)\"}";
+        } else {
+            status_line = "HTTP/1.1 400 Bad Request";
+            response_body = "{\"code\":\"BAD_REQUEST\",\"message\":\"format must be csv or ndjson\"}";
+        }
+    }
+
     // ---------- HEALTH & ROOT ----------
     // ---------- ATTEMPTS: POST /api/tests/{id}/submit ----------
 else if (method == "POST" && path.find("/api/tests/") == 0 && path.size() > std::string("/api/tests/").size() + std::string("/submit").size() && path.rfind("/submit") == path.size() - 7) {
@@ -259,16 +538,7 @@ else if (method == "POST" && path.find("/api/tests/") == 0 && path.size() > std:
 
     if (test_id != 0) {
         // Получить Authorization header (временно: "Bearer <user_id>" используется для тестирования)
-        std::string auth_header = "";
-        if (request_data.count("hdr:Authorization")) auth_header = request_data.at("hdr:Authorization");
-        int user_id = 0;
-        if (!auth_header.empty()) {
-            size_t pos = auth_header.find(" ");
-            if (pos != std::string::npos) {
-                std::string token = auth_header.substr(pos + 1);
-                try { user_id = std::stoi(token); } catch (...) { user_id = 0; }
-            }
-        }
+        int user_id = user_id_from_auth(request_data);
         if (user_id == 0) {
             status_line = "HTTP/1.1 401 Unauthorized";
             response_body = "{\"code\":\"UNAUTHORIZED\",\"message\":\"Missing or invalid Authorization header (use 'Bearer <user_id>' for now)\"}";
@@ -279,22 +549,26 @@ else if (method == "POST" && path.find("/api/tests/") == 0 && path.size() > std:
 
             // Проверка существования теста
             try {
-                pqxx::work w(db.conn());
-                pqxx::result r = w.exec_params("SELECT id FROM tests WHERE id = $1", test_id);
+                Database::Timer db_timer("submit_attempt");
+                // Проверка и вставка в одной транзакции: вторая pqxx::work на том же
+                // соединении при открытой первой бросает исключение
+                pqxx::work tx(db.conn());
+                pqxx::result r = tx.exec_params("SELECT id, time_limit_minutes FROM tests WHERE id = $1", test_id);
                 if (r.empty()) {
                     status_line = "HTTP/1.1 404 Not Found";
                     response_body = "{\"code\":\"NOT_FOUND\",\"message\":\"Test not found\"}";
                 } else {
                     // Вставка попытки (answers сохраняем в поле answers JSONB)
-                    pqxx::work tx(db.conn());
                     pqxx::result ins = tx.exec_params(
                         "INSERT INTO attempts (user_id, test_id, answers, status) VALUES ($1, $2, $3::jsonb, $4) RETURNING id, started_at",
                         user_id, test_id, answers_json, std::string("in_progress")
                     );
                     tx.commit();
+                    db.note_write();
 
                     int attempt_id = ins[0][0].as<int>();
                     std::string started_at = ins[0][1].as<std::string>();
+                    if (!r[0][1].is_null()) expiryService.track(attempt_id, r[0][1].as<int64_t>() * 60);
 
                     // Сформировать ответ вручную (без внешних JSON-библиотек)
                     std::ostringstream oss;
@@ -308,12 +582,46 @@ else if (method == "POST" && path.find("/api/tests/") == 0 && path.size() > std:
                 }
             } catch (const std::exception &e) {
                 status_line = "HTTP/1.1 500 Internal Server Error";
-                response_body = std::string("{\"code\":\"DB_ERROR\",\"message\":\"") + e.what() + "\"}";
+                response_body = std::string("{\"code\":\"DB_ERROR\",\"message\":\"") + http::json_escape(e.what()) + "\"}";
             }
         }
     }
 }
 
+    // ---------- ATTEMPTS: POST /api/attempts/{id}/finish ----------
+    else if (method == "POST" && extract_id_between(path, "/api/attempts/", "/finish")) {
+        int attempt_id = extract_id_between(path, "/api/attempts/", "/finish").value();
+        int user_id = user_id_from_auth(request_data);
+        if (user_id == 0) {
+            status_line = "HTTP/1.1 401 Unauthorized";
+            response_body = "{\"code\":\"UNAUTHORIZED\",\"message\":\"Missing or invalid Authorization header (use 'Bearer <user_id>' for now)\"}";
+        } else {
+            try {
+                Database::Timer db_timer("finish_attempt");
+                pqxx::work tx(db.conn());
+                pqxx::result r = tx.exec_params(
+                    "UPDATE attempts SET status = 'finished', finished_at = NOW() "
+                    "WHERE id = $1 AND user_id = $2 AND status = 'in_progress' RETURNING finished_at",
+                    attempt_id, user_id
+                );
+                tx.commit();
+                if (r.empty()) {
+                    status_line = "HTTP/1.1 409 Conflict";
+                    response_body = "{\"code\":\"NOT_IN_PROGRESS\",\"message\":\"Attempt not found, expired or already finished\"}";
+                } else {
+                    db.note_write();
+                    expiryService.finish(attempt_id);
+                    status_line = "HTTP/1.1 200 OK";
+                    response_body = "{\"attempt_id\":" + std::to_string(attempt_id) +
+                                    ",\"finished_at\":\"" + r[0][0].as<std::string>() + "\",\"status\":\"finished\"}";
+                }
+            } catch (const std::exception &e) {
+                status_line = "HTTP/1.1 500 Internal Server Error";
+                response_body = std::string("{\"code\":\"DB_ERROR\",\"message\":\"") + http::json_escape(e.what()) + "\"}";
+            }
+        }
+    }
+
     else if (path == "/health") {
         try {
             pqxx::connection C(db.get_connection_string());
@@ -333,13 +641,49 @@ else if (method == "POST" && path.find("/api/tests/") == 0 && path.size() > std:
         response_body = "{\"message\":\"Not Found\"}";
     }
 
+    route_span.reset();
+
+    // Сжатие: кэшированные тела сжимаются один раз, остальные — если не меньше порога
+    const std::string* body = cached ? &cached->raw : &response_body;
+    std::string encoding_header;
+    std::string compressed;
+    if (compression.enabled && body->size() >= compression.min_bytes) {
+        http::Encoding enc = http::negotiate(header_value(request_data, "Accept-Encoding"));
+        if (enc != http::Encoding::Identity) {
+            trace::Span compress_span("compress");
+            try {
+                if (cached) {
+                    body = &compression.cache.encoded(*cached, enc, compression.compressor);
+                } else {
+                    compressed = compression.compressor.compress(enc, *body);
+                    body = &compressed;
+                }
+                encoding_header = std::string("Content-Encoding: ") + http::encoding_name(enc) + "\r\n";
+            } catch (const std::exception& e) {
+                std::cerr << "compression failed: " << e.what() << std::endl;
+            }
+        }
+        encoding_header += "Vary: Accept-Encoding\r\n";
+    }
+
     std::string response = status_line + "\r\n";
     response += "Content-Type: application/json\r\n";
-    response += "Content-Length: " + std::to_string(response_body.length()) + "\r\n";
+    response += encoding_header;
+    response += "Content-Length: " + std::to_string(body->length()) + "\r\n";
+    if (trace::server_timing_enabled() && trace::RequestTrace::current()) {
+        response += "Server-Timing: " + trace::RequestTrace::current()->server_timing() + "\r\n";
+    }
     response += "\r\n";
-    response += response_body;
+    response += *body;
     return response;
 }
+// SIGTERM/SIGINT: цикл сервера завершается, деструкторы закрывают сокеты и журналы
+volatile std::sig_atomic_t g_stop = 0;
+
+void handle_stop_signal(int) {
+    g_stop = 1;
+}
+
 int main() {
     const char* db_url_env = std::getenv("DATABASE_URL");
     if (!db_url_env) {
@@ -347,46 +691,312 @@ int main() {
         return 1;
     }
 
-    Database db(db_url_env);
+    // Реплики для чтения: DATABASE_REPLICA_URLS="postgresql://...,postgresql://..."
+    std::vector<std::string> replica_urls;
+    if (const char* replicas_env = std::getenv("DATABASE_REPLICA_URLS")) {
+        std::stringstream ss(replicas_env);
+        std::string url;
+        while (std::getline(ss, url, ',')) if (!url.empty()) replica_urls.push_back(url);
+    }
+
+    Database db(db_url_env, replica_urls);
     TestService testService(db);
     QuestionService questionService(db);
     AnswerService answerService(db);
 
-    int server_fd, new_socket;
-    struct sockaddr_in address;
-    int addrlen = sizeof(address);
-    int port = 8080;
+    const char* snapshot_dir_env = std::getenv("SNAPSHOT_DIR");
+    SnapshotService snapshotService(db, testService, questionService, answerService,
+                                    snapshot_dir_env ? snapshot_dir_env : "snapshots");
+    std::cout << "Snapshots loaded: " << snapshotService.load_all() << std::endl;
+
+    AttemptExpiryService expiryService(db);
+    try {
+        std::cout << "Active timed attempts: " << expiryService.load_active() << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "attempt expiry disabled at startup: " << e.what() << std::endl;
+    }
 
-    if ((server_fd = socket(AF_INET, SOCK_STREAM, 0)) == 0) {
-        perror("socket failed");
-        exit(EXIT_FAILURE);
+    // Индекс поиска по вопросам: строится при старте в SEARCH_INDEX_THREADS потоках
+    SearchIndex searchIndex;
+    {
+        const char* threads_env = std::getenv("SEARCH_INDEX_THREADS");
+        unsigned threads = threads_env ? std::strtoul(threads_env, nullptr, 10) : std::thread::hardware_concurrency();
+        auto started = std::chrono::steady_clock::now();
+        try {
+            searchIndex.rebuild(questionService.list_all(), threads);
+        } catch (const std::exception& e) {
+            std::cerr << "❌ Search index: " << e.what() << std::endl;
+            return 1;
+        }
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started).count();
+        std::cout << "Search index: " << searchIndex.size() << " questions in " << ms << " ms" << std::endl;
     }
-    address.sin_family = AF_INET;
-    address.sin_addr.s_addr = INADDR_ANY;
-    address.sin_port = htons(port);
+    testService.attach_index(&searchIndex);
+    questionService.attach_index(&searchIndex);
+
+    const char* batch_max_env = std::getenv("BATCH_MAX_OPS");
+    BatchService batchService(db, testService, questionService, answerService,
+                              batch_max_env ? std::strtoul(batch_max_env, nullptr, 10) : 500);
+    batchService.attach_index(&searchIndex);
+    batchService.attach_snapshots(&snapshotService);
 
-    if (bind(server_fd, (struct sockaddr *)&address, sizeof(address)) < 0) {
-        perror("bind failed");
-        exit(EXIT_FAILURE);
+    const char* export_max_env = std::getenv("EXPORT_MAX_CONCURRENT");
+    const char* export_timeout_env = std::getenv("EXPORT_SEND_TIMEOUT_S");
+    ExportService exportService(db, export_max_env ? std::strtoul(export_max_env, nullptr, 10) : 4,
+                                export_timeout_env ? std::atoi(export_timeout_env) : 60);
+    // Через сколько секунд повторить выгрузку, отклонённую лимитом EXPORT_MAX_CONCURRENT
+    const char* export_retry_env = std::getenv("EXPORT_RETRY_AFTER_S");
+    const int export_retry_after_s = export_retry_env ? std::atoi(export_retry_env) : 5;
+
+    const char* compress_level_env = std::getenv("COMPRESS_LEVEL");
+    const char* compress_cache_env = std::getenv("COMPRESS_CACHE_MB");
+    http::Compression compression(compress_level_env ? std::atoi(compress_level_env) : 6,
+                                  (compress_cache_env ? std::atoi(compress_cache_env) : 64) * 1024UL * 1024UL);
+    if (const char* v = std::getenv("COMPRESS_MIN_BYTES")) compression.min_bytes = std::strtoul(v, nullptr, 10);
+    if (const char* v = std::getenv("COMPRESS_ENABLED")) compression.enabled = std::string(v) != "0";
+    // Снимок пересобран или удалён — его JSON и сжатые варианты в кэше устарели
+    snapshotService.set_on_change([&compression](int test_id) {
+        compression.cache.invalidate("/tests/" + std::to_string(test_id) + "/snapshot");
+    });
+
+    http::Admission admission(http::AdmissionConfig::from_env());
+
+    // Запись трафика для core-replay: CAPTURE_FILE, CAPTURE_MAX_MB (по умолчанию 1024)
+    std::unique_ptr<http::CaptureWriter> capture;
+    if (const char* capture_path = std::getenv("CAPTURE_FILE")) {
+        const char* max_mb_env = std::getenv("CAPTURE_MAX_MB");
+        capture = std::make_unique<http::CaptureWriter>(capture_path,
+                                                        (max_mb_env ? std::strtoul(max_mb_env, nullptr, 10) : 1024) * 1024UL * 1024UL);
+        std::cout << "Capturing requests to " << capture_path << std::endl;
     }
-    if (listen(server_fd, 10) < 0) {
-        perror("listen");
-        exit(EXIT_FAILURE);
+
+    // Журнал доступа включается переменной ACCESS_LOG_FILE
+    std::unique_ptr<http::AccessLog> access_log;
+    if (const char* log_path = std::getenv("ACCESS_LOG_FILE")) {
+        const char* max_mb_env = std::getenv("ACCESS_LOG_MAX_MB");
+        const char* keep_env = std::getenv("ACCESS_LOG_KEEP");
+        access_log = std::make_unique<http::AccessLog>(log_path, 1 << 16,
+                                                       (max_mb_env ? std::atoi(max_mb_env) : 100) * 1024UL * 1024UL,
+                                                       keep_env ? std::atoi(keep_env) : 5);
     }
 
+    // Слушающие сокеты: LISTEN="tcp:0.0.0.0:8082,unix:/run/core/core.sock"
+    // (по умолчанию TCP на PORT или 8080), права Unix-сокета — UNIX_SOCKET_MODE (восьмеричное)
+    const char* listen_env = std::getenv("LISTEN");
+    const char* port_env = std::getenv("PORT");
+    const char* unix_mode_env = std::getenv("UNIX_SOCKET_MODE");
+    http::ListenerSet listeners;
+    try {
+        std::string spec = listen_env ? listen_env : std::string("tcp:0.0.0.0:") + (port_env ? port_env : "8080");
+        mode_t unix_mode = unix_mode_env ? static_cast<mode_t>(std::strtoul(unix_mode_env, nullptr, 8)) : 0660;
+        for (const auto& ls : http::parse_listen_specs(spec, unix_mode)) {
+            listeners.open(ls, admission.config().backlog);
+            std::cout << "Listening on " << (ls.kind == http::ListenSpec::Kind::Unix
+                                                 ? "unix:" + ls.path
+                                                 : ls.host + ":" + std::to_string(ls.port)) << std::endl;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "❌ " << e.what() << std::endl;
+        return 1;
+    }
+
+    // Трассировка: SERVER_TIMING=1 — заголовок Server-Timing; TRACE_FILE — выгрузка
+    // каждой TRACE_SAMPLE_EVERY-й трассы и всех медленнее TRACE_SLOW_MS в формате Chrome
+    const char* server_timing_env = std::getenv("SERVER_TIMING");
+    trace::set_server_timing(server_timing_env && std::string(server_timing_env) == "1");
+    std::unique_ptr<trace::TraceSink> trace_sink;
+    if (const char* trace_file = std::getenv("TRACE_FILE")) {
+        const char* every_env = std::getenv("TRACE_SAMPLE_EVERY");
+        const char* slow_env = std::getenv("TRACE_SLOW_MS");
+        trace_sink = std::make_unique<trace::TraceSink>(trace_file,
+                                                        every_env ? std::strtoull(every_env, nullptr, 10) : 100,
+                                                        slow_env ? std::atof(slow_env) * 1000.0 : 0.0);
+    }
+    const bool tracing = trace::server_timing_enabled() || trace_sink;
+    if (tracing) trace::calibrate();
+    trace::RequestTrace request_trace;
+    uint64_t request_seq = 0;
+
+    const char* max_request_env = std::getenv("MAX_REQUEST_BYTES");
+    const size_t max_request_bytes = max_request_env ? std::strtoul(max_request_env, nullptr, 10) : (1 << 20);
+    // Срок на чтение всего запроса и на каждую отправку ответа
+    const char* request_timeout_env = std::getenv("REQUEST_TIMEOUT_MS");
+    const int request_timeout_ms = request_timeout_env ? std::atoi(request_timeout_env) : 5000;
+
+    // Без SA_RESTART: poll в accept_next прерывается сигналом сразу
+    struct sigaction stop_action{};
+    stop_action.sa_handler = handle_stop_signal;
+    sigemptyset(&stop_action.sa_mask);
+    sigaction(SIGTERM, &stop_action, nullptr);
+    sigaction(SIGINT, &stop_action, nullptr);
+    // Запись в закрытый клиентом сокет должна давать EPIPE, а не завершать процесс
+    // (MSG_NOSIGNAL ставим и сами, это страховка для остальных записей)
+    signal(SIGPIPE, SIG_IGN);
+
     std::cout << "=== CORE API SERVER ===" << std::endl;
 
-    while (true) {
-        new_socket = accept(server_fd, (struct sockaddr *)&address, (socklen_t*)&addrlen);
-        if (new_socket < 0) {
-            perror("accept");
+    while (!g_stop) {
+        // Таймаут poll в секунду — чтобы колесо попыток тикало и без входящих запросов
+        expiryService.tick();
+        http::AcceptedClient client;
+        if (!listeners.accept_next(1000, client)) continue;
+        int new_socket = client.fd;
+        auto started = std::chrono::system_clock::now();
+        auto started_steady = std::chrono::steady_clock::now();
+        Database::take_time_us();  // сбросить время БД прошлого запроса
+        if (tracing) request_trace.begin(++request_seq);
+
+        // Клиент, переставший читать ответ, тоже не должен держать сервер
+        timeval send_timeout{request_timeout_ms / 1000, (request_timeout_ms % 1000) * 1000};
+        setsockopt(new_socket, SOL_SOCKET, SO_SNDTIMEO, &send_timeout, sizeof(send_timeout));
+
+        std::string request;
+        bool request_too_large = false;
+        {
+            trace::Span read_span("read");
+            request = read_http_request(new_socket, max_request_bytes, request_timeout_ms, request_too_large);
+        }
+        if (request_too_large) {
+            std::string body = "{\"code\":\"PAYLOAD_TOO_LARGE\",\"message\":\"Request exceeds " +
+                               std::to_string(max_request_bytes) + " bytes\"}";
+            std::string response = status_line_for(413) + "\r\nContent-Type: application/json\r\n";
+            response += "Content-Length: " + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+            send_all(new_socket, response);
+            request_trace.end();
+            close(new_socket);
+            continue;
+        }
+        if (request.empty()) {
+            request_trace.end();
+            close(new_socket);
             continue;
         }
-        std::string request = read_http_request(new_socket);
-        std::string response = handle_request(request, testService, questionService, answerService, db);
-        send(new_socket, response.c_str(), response.size(), 0);
-        close(new_socket);
+        if (capture) capture->record(request);
+        std::map<std::string, std::string> request_data;
+        {
+            trace::Span parse_span("parse");
+            request_data = parse_request(request);
+        }
+
+        // Контроль допуска: IP — адрес пира; X-Real-IP (его ставит nginx) учитываем только
+        // от Unix-сокета или доверенного прокси, иначе клиент менял бы бакет подменой заголовка.
+        // Глубину очереди accept знаем только для TCP — на Unix-сокете работают лишь лимиты
+        std::string client_ip = client.peer_ip;
+        if (!client.tcp || admission.config().trusts_proxy(client.peer_ip)) {
+            std::string real_ip = header_value(request_data, "X-Real-IP");
+            if (!real_ip.empty()) client_ip = real_ip;
+        }
+        http::RouteClass route_class = http::classify_route(request_data["method"], request_data["path"]);
+        int user_id = user_id_from_auth(request_data);
+        db.begin_request(user_id);
+        http::AdmissionDecision decision;
+        if (request_data["path"] != "/health") {
+            trace::Span admission_span("admission");
+            decision = admission.check(route_class, user_id, client_ip,
+                                       client.tcp ? http::Admission::accept_queue_depth(client.listener_fd) : -1);
+        }
+
+        // Выгрузка попыток пишет ответ в сокет сама, в отдельном потоке; запись в журнал — по её окончании.
+        // Без авторизации запрос уходит в handle_request и получает 401, как /finish
+        bool export_busy = false;
+        if (decision.admit && request_data["method"] == "GET" && user_id != 0) {
+            auto export_test_id = extract_id_between(request_data["path"], "/tests/", "/attempts/export");
+            auto format = ExportService::parse_format(query_param(request_data, "format").value_or("csv"));
+            if (export_test_id && format) {
+                std::string method = request_data["method"];
+                std::string route = http::route_pattern(request_data["path"]);
+                auto on_done = [&access_log, started, started_steady, user_id, method, route](int status, uint64_t bytes) {
+                    if (!access_log) return;
+                    http::AccessRecord rec{};
+                    rec.ts_us = std::chrono::duration_cast<std::chrono::microseconds>(started.time_since_epoch()).count();
+                    rec.latency_us = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::steady_clock::now() - started_steady).count());
+                    rec.bytes = static_cast<uint32_t>(std::min<uint64_t>(bytes, UINT32_MAX));
+                    rec.user_id = user_id;
+                    rec.status = static_cast<uint16_t>(status);
+                    http::AccessLog::set_text(rec.method, sizeof(rec.method), method);
+                    http::AccessLog::set_text(rec.route, sizeof(rec.route), route);
+                    access_log->log(rec);
+                };
+                if (exportService.start(new_socket, *export_test_id, user_id, *format, on_done)) {
+                    request_trace.end();
+                    continue;
+                }
+                export_busy = true;
+            }
+        }
+
+        std::string response;
+        if (export_busy) {
+            std::string body = "{\"code\":\"EXPORT_BUSY\",\"message\":\"Too many exports in progress, try again later\"}";
+            response = "HTTP/1.1 503 Service Unavailable\r\n";
+            response += "Content-Type: application/json\r\n";
+            response += "Retry-After: " + std::to_string(export_retry_after_s) + "\r\n";
+            response += "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n";
+            response += body;
+        } else if (decision.admit) {
+            auto handle = [&]() {
+                return handle_request(request_data, testService, questionService, answerService, snapshotService,
+                                      batchService, expiryService, searchIndex, compression, db);
+            };
+            try {
+                response = handle();
+            } catch (const pqxx::broken_connection& e) {
+                // Соединение с БД оборвалось посреди запроса. Если это была реплика, чтение
+                // повторяем (оно уйдёт на primary); изменения не повторяем — только 503
+                std::cerr << "database connection lost: " << e.what() << std::endl;
+                response.clear();
+                if (db.drop_request_replicas() && request_data["method"] == "GET") {
+                    try {
+                        response = handle();
+                    } catch (const pqxx::broken_connection& retry_error) {
+                        std::cerr << "database connection lost on retry: " << retry_error.what() << std::endl;
+                    }
+                }
+                if (response.empty()) {
+                    std::string body = "{\"code\":\"DB_UNAVAILABLE\",\"message\":\"Database connection lost, try again\"}";
+                    response = "HTTP/1.1 503 Service Unavailable\r\n";
+                    response += "Content-Type: application/json\r\n";
+                    response += "Retry-After: 1\r\n";
+                    response += "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n";
+                    response += body;
+                }
+            }
+        } else {
+            std::string body = std::string("{\"code\":\"") + decision.reason + "\",\"message\":\"Try again later\"}";
+            response = decision.status == 429 ? "HTTP/1.1 429 Too Many Requests\r\n" : "HTTP/1.1 503 Service Unavailable\r\n";
+            response += "Content-Type: application/json\r\n";
+            response += "Retry-After: " + std::to_string(decision.retry_after_s) + "\r\n";
+            response += "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n";
+            response += body;
+        }
+        {
+            trace::Span send_span("send");
+            send_all(new_socket, response);
+            close(new_socket);
+        }
+        request_trace.end();
+        if (trace_sink && tracing && trace_sink->should_dump(request_trace)) {
+            trace_sink->dump(request_trace, request_data["method"] + " " + request_data["path"]);
+        }
+
+        if (access_log) {
+            http::AccessRecord rec{};
+            rec.ts_us = std::chrono::duration_cast<std::chrono::microseconds>(started.time_since_epoch()).count();
+            rec.latency_us = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - started_steady).count());
+            rec.db_us = static_cast<uint32_t>(Database::take_time_us());
+            rec.bytes = static_cast<uint32_t>(response.size());
+            rec.user_id = user_id;
+            rec.status = static_cast<uint16_t>(std::atoi(response.c_str() + 9));  // "HTTP/1.1 NNN"
+            http::AccessLog::set_text(rec.method, sizeof(rec.method), request_data["method"]);
+            http::AccessLog::set_text(rec.route, sizeof(rec.route), http::route_pattern(request_data["path"]));
+            access_log->log(rec);
+        }
     }
 
+    std::cout << "Shutting down" << std::endl;
+    // Потоки выгрузок пишут в журнал доступа — даём им закончить (каждую ограничивает EXPORT_SEND_TIMEOUT_S)
+    while (exportService.running() > 0) std::this_thread::sleep_for(std::chrono::milliseconds(100));
     return 0;
 }
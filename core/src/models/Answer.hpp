@@ -1,5 +1,6 @@
 #pragma once
 #include <string>
+#include "../http/Json.hpp"
 
 struct Answer {
     int id;
@@ -11,6 +12,6 @@ struct Answer {
 inline std::string answerToJson(const Answer& a) {
     return "{\"id\":" + std::to_string(a.id) +
            ",\"question_id\":" + std::to_string(a.question_id) +
-           ",\"text\":\"" + a.text + "\"" +
+           ",\"text\":\"" + http::json_escape(a.text) + "\"" +
            ",\"is_correct\":" + (a.is_correct ? "true" : "false") + "}";
 }
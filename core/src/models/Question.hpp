@@ -1,5 +1,6 @@
 #pragma once
 #include <string>
+#include "../http/Json.hpp"
 
 struct Question {
     int id;
@@ -12,7 +13,7 @@ struct Question {
 inline std::string questionToJson(const Question& q) {
     return "{\"id\":" + std::to_string(q.id) +
            ",\"test_id\":" + std::to_string(q.test_id) +
-           ",\"text\":\"" + q.text + "\"" +
-           ",\"type\":\"" + q.type + "\"" +
+           ",\"text\":\"" + http::json_escape(q.text) + "\"" +
+           ",\"type\":\"" + http::json_escape(q.type) + "\"" +
            ",\"order_index\":" + std::to_string(q.order_index) + "}";
 }
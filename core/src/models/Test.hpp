@@ -1,5 +1,6 @@
 #pragma once
 #include <string>
+#include "../http/Json.hpp"
 #include <optional>
 
 struct Test {
@@ -13,9 +14,9 @@ struct Test {
 inline std::string testToJson(const Test& t) {
     std::string json = "{";
     json += "\"id\":" + std::to_string(t.id) + ",";
-    json += "\"title\":\"" + t.title + "\"";
+    json += "\"title\":\"" + http::json_escape(t.title) + "\"";
     if (t.description.has_value())
-        json += ",\"description\":\"" + *t.description + "\"";
+        json += ",\"description\":\"" + http::json_escape(*t.description) + "\"";
     if (t.author_id.has_value())
         json += ",\"author_id\":" + std::to_string(*t.author_id);
     json += ",\"is_published\":" + std::string(t.is_published ? "true" : "false");
@@ -0,0 +1,417 @@
+#include "SearchIndex.hpp"
+#include <algorithm>
+#include <thread>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+uint64_t trigram_key(char32_t a, char32_t b, char32_t c) {
+  return (static_cast<uint64_t>(a) << 42) | (static_cast<uint64_t>(b) << 21) | static_cast<uint64_t>(c);
+}
+
+// Уникальные триграммы слов длиной от 3 символов
+std::vector<uint64_t> trigrams(const std::u32string& norm) {
+  std::vector<uint64_t> out;
+  for (size_t i = 0; i + 2 < norm.size(); ++i) {
+    if (norm[i] == U' ' || norm[i + 1] == U' ' || norm[i + 2] == U' ') continue;
+    out.push_back(trigram_key(norm[i], norm[i + 1], norm[i + 2]));
+  }
+  std::sort(out.begin(), out.end());
+  out.erase(std::unique(out.begin(), out.end()), out.end());
+  return out;
+}
+
+void put_varint(std::vector<uint8_t>& out, uint32_t v) {
+  while (v >= 0x80) {
+    out.push_back(static_cast<uint8_t>(v | 0x80));
+    v >>= 7;
+  }
+  out.push_back(static_cast<uint8_t>(v));
+}
+
+size_t intersect_scalar(const uint32_t* a, size_t na, const uint32_t* b, size_t nb, uint32_t* out) {
+  size_t i = 0, j = 0, k = 0;
+  while (i < na && j < nb) {
+    if (a[i] < b[j]) ++i;
+    else if (a[i] > b[j]) ++j;
+    else { out[k++] = a[i]; ++i; ++j; }
+  }
+  return k;
+}
+
+// Пересечение отсортированных массивов без повторов. out может совпадать с a.
+size_t intersect(const uint32_t* a, size_t na, const uint32_t* b, size_t nb, uint32_t* out) {
+#if defined(__SSE2__)
+  // Блоки по 4: каждый элемент блока a сравнивается со всеми 4 элементами блока b
+  // через 4 циклических сдвига. Сравнение знаковое, id вопросов < 2^31.
+  size_t i = 0, j = 0, k = 0;
+  while (i + 4 <= na && j + 4 <= nb) {
+    __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+    __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + j));
+    __m128i m = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi32(va, vb), _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(0, 3, 2, 1)))),
+        _mm_or_si128(_mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(1, 0, 3, 2))),
+                     _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(2, 1, 0, 3)))));
+    int mask = _mm_movemask_ps(_mm_castsi128_ps(m));
+    uint32_t a_max = a[i + 3], b_max = b[j + 3];
+    for (int bit = 0; bit < 4; ++bit) {
+      if (mask & (1 << bit)) out[k++] = a[i + bit];
+    }
+    if (a_max <= b_max) i += 4;
+    if (b_max <= a_max) j += 4;
+  }
+  return k + intersect_scalar(a + i, na - i, b + j, nb - j, out + k);
+#else
+  return intersect_scalar(a, na, b, nb, out);
+#endif
+}
+
+void append_utf8(std::u32string& out, const std::string& s, size_t& i) {
+  unsigned char c = static_cast<unsigned char>(s[i]);
+  char32_t cp;
+  size_t len;
+  if (c < 0x80) { cp = c; len = 1; }
+  else if ((c >> 5) == 0x6) { cp = c & 0x1F; len = 2; }
+  else if ((c >> 4) == 0xE) { cp = c & 0x0F; len = 3; }
+  else if ((c >> 3) == 0x1E) { cp = c & 0x07; len = 4; }
+  else { ++i; return; }
+  if (i + len > s.size()) { i = s.size(); return; }
+  for (size_t k = 1; k < len; ++k) cp = (cp << 6) | (static_cast<unsigned char>(s[i + k]) & 0x3F);
+  i += len;
+  out += cp;
+}
+
+void append_utf8_out(std::string& out, char32_t cp) {
+  if (cp < 0x80) {
+    out += static_cast<char>(cp);
+  } else if (cp < 0x800) {
+    out += static_cast<char>(0xC0 | (cp >> 6));
+    out += static_cast<char>(0x80 | (cp & 0x3F));
+  } else if (cp < 0x10000) {
+    out += static_cast<char>(0xE0 | (cp >> 12));
+    out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+    out += static_cast<char>(0x80 | (cp & 0x3F));
+  } else {
+    out += static_cast<char>(0xF0 | (cp >> 18));
+    out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+    out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+    out += static_cast<char>(0x80 | (cp & 0x3F));
+  }
+}
+
+// Нормализованный текст обратно в UTF-8: проверка подстрокой идёт по байтам (memchr/memcmp)
+std::string to_utf8(const std::u32string& s) {
+  std::string out;
+  out.reserve(s.size() * 2);
+  for (char32_t cp : s) append_utf8_out(out, cp);
+  return out;
+}
+
+} // namespace
+
+std::u32string SearchIndex::normalize(const std::string& text) {
+  std::u32string raw;
+  raw.reserve(text.size());
+  for (size_t i = 0; i < text.size();) append_utf8(raw, text, i);
+
+  std::u32string out;
+  out.reserve(raw.size());
+  for (char32_t c : raw) {
+    if (c >= U'A' && c <= U'Z') c = c - U'A' + U'a';
+    else if (c >= 0x0410 && c <= 0x042F) c += 0x20;  // А-Я -> а-я
+    else if (c == 0x0401 || c == 0x0451) c = 0x0435;  // Ё, ё -> е
+
+    bool word = (c >= U'a' && c <= U'z') || (c >= U'0' && c <= U'9') || (c >= 0x0430 && c <= 0x044F) || c > 0x04FF;
+    if (!word) c = U' ';
+    if (c == U' ' && (out.empty() || out.back() == U' ')) continue;
+    out += c;
+  }
+  if (!out.empty() && out.back() == U' ') out.pop_back();
+  return out;
+}
+
+SearchIndex::SearchIndex() : postings_(std::make_unique<PostingsMap>()) {}
+
+SearchIndex::~SearchIndex() { join_background(); }
+
+void SearchIndex::join_background() {
+  if (background_.joinable()) background_.join();
+}
+
+void SearchIndex::rebuild(std::vector<Question> questions, unsigned threads) {
+  // Результат незавершённой фоновой сборки устарел вместе с документами
+  join_background();
+  rebuilt_.reset();
+  rebuilt_ready_.store(false);
+  rebuilding_ = false;
+  changed_since_snapshot_.clear();
+
+  docs_.clear();
+  docs_.reserve(questions.size());
+  for (auto& q : questions) {
+    Doc d{std::move(q), {}};
+    int id = d.question.id;
+    docs_[id] = std::move(d);
+  }
+  build_postings(threads);
+}
+
+void SearchIndex::build_postings(unsigned threads) {
+  std::vector<std::pair<uint32_t, const std::string*>> texts;
+  std::vector<Doc*> order;
+  texts.reserve(docs_.size());
+  order.reserve(docs_.size());
+  for (auto& kv : docs_) order.push_back(&kv.second);
+  std::sort(order.begin(), order.end(), [](const Doc* a, const Doc* b) { return a->question.id < b->question.id; });
+  for (Doc* d : order) texts.emplace_back(static_cast<uint32_t>(d->question.id), &d->question.text);
+
+  std::vector<std::string> norms;
+  postings_ = pack_postings(texts, threads, &norms);
+  for (size_t i = 0; i < order.size(); ++i) order[i]->norm = std::move(norms[i]);
+  fresh_total_ = 0;
+}
+
+std::unique_ptr<SearchIndex::PostingsMap> SearchIndex::pack_postings(
+    const std::vector<std::pair<uint32_t, const std::string*>>& texts, unsigned threads, std::vector<std::string>* norms) {
+  // Документы по возрастанию id делятся на непрерывные диапазоны, каждый поток
+  // строит постинги своего диапазона
+  if (norms) norms->assign(texts.size(), {});
+  if (threads == 0) threads = 1;
+  if (threads > texts.size() / 1024 + 1) threads = static_cast<unsigned>(texts.size() / 1024 + 1);
+  std::vector<std::unordered_map<uint64_t, std::vector<uint32_t>>> partial(threads);
+  std::vector<std::thread> workers;
+  const size_t chunk = (texts.size() + threads - 1) / threads;
+  for (unsigned t = 0; t < threads; ++t) {
+    workers.emplace_back([&, t] {
+      size_t begin = t * chunk, end = std::min(texts.size(), begin + chunk);
+      for (size_t i = begin; i < end; ++i) {
+        std::u32string norm = normalize(*texts[i].second);
+        if (norms) (*norms)[i] = to_utf8(norm);
+        for (uint64_t g : trigrams(norm)) partial[t][g].push_back(texts[i].first);
+      }
+    });
+  }
+  for (auto& w : workers) w.join();
+
+  // Склейка частей в порядке потоков сразу даёт отсортированные списки
+  std::unordered_map<uint64_t, std::vector<uint32_t>> merged = std::move(partial[0]);
+  for (unsigned t = 1; t < threads; ++t) {
+    for (auto& kv : partial[t]) {
+      auto& dst = merged[kv.first];
+      dst.insert(dst.end(), kv.second.begin(), kv.second.end());
+    }
+    partial[t].clear();
+  }
+
+  auto out = std::make_unique<PostingsMap>();
+  out->reserve(merged.size());
+  for (auto& kv : merged) {
+    Postings& p = (*out)[kv.first];
+    uint32_t prev = 0;
+    for (uint32_t id : kv.second) {
+      put_varint(p.packed, id - prev);
+      prev = id;
+    }
+    p.packed.shrink_to_fit();
+    p.packed_count = static_cast<uint32_t>(kv.second.size());
+  }
+  return out;
+}
+
+void SearchIndex::start_background_rebuild() {
+  // Снимок текстов копируется здесь: дальше поток не трогает docs_
+  std::vector<std::pair<uint32_t, std::string>> snapshot;
+  snapshot.reserve(docs_.size());
+  for (const auto& kv : docs_) snapshot.emplace_back(static_cast<uint32_t>(kv.first), kv.second.question.text);
+  std::sort(snapshot.begin(), snapshot.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+  join_background();  // мог ещё освобождать прошлую карту
+  changed_since_snapshot_.clear();
+  rebuilding_ = true;
+  // Один поток сервера остаётся на запросы
+  unsigned hc = std::thread::hardware_concurrency();
+  unsigned threads = hc > 1 ? hc - 1 : 1;
+  background_ = std::thread([this, threads, snapshot = std::move(snapshot)] {
+    std::vector<std::pair<uint32_t, const std::string*>> texts;
+    texts.reserve(snapshot.size());
+    for (const auto& s : snapshot) texts.emplace_back(s.first, &s.second);
+    rebuilt_ = pack_postings(texts, threads, nullptr);
+    rebuilt_ready_.store(true);
+  });
+}
+
+void SearchIndex::adopt_background_rebuild() {
+  if (!rebuilding_ || !rebuilt_ready_.load()) return;
+  join_background();
+  rebuilt_ready_.store(false);
+  rebuilding_ = false;
+
+  postings_.swap(rebuilt_);
+  fresh_total_ = 0;
+  // Изменённые после снимка вопросы — снова в свежие постинги новой карты
+  std::sort(changed_since_snapshot_.begin(), changed_since_snapshot_.end());
+  changed_since_snapshot_.erase(std::unique(changed_since_snapshot_.begin(), changed_since_snapshot_.end()),
+                                changed_since_snapshot_.end());
+  for (int id : changed_since_snapshot_) {
+    auto it = docs_.find(id);
+    if (it != docs_.end()) add_fresh(static_cast<uint32_t>(id), normalize(it->second.question.text));
+  }
+  changed_since_snapshot_.clear();
+
+  // Старая карта — миллионы мелких векторов: освобождаем её не в потоке сервера
+  background_ = std::thread([old = std::move(rebuilt_)]() mutable { old.reset(); });
+}
+
+std::vector<uint32_t> SearchIndex::decode(const Postings& p) const {
+  std::vector<uint32_t> out;
+  out.reserve(p.packed_count + p.fresh.size());
+  uint32_t prev = 0;
+  size_t i = 0;
+  while (i < p.packed.size()) {
+    uint32_t v = 0;
+    int shift = 0;
+    while (p.packed[i] & 0x80) {
+      v |= static_cast<uint32_t>(p.packed[i++] & 0x7F) << shift;
+      shift += 7;
+    }
+    v |= static_cast<uint32_t>(p.packed[i++]) << shift;
+    prev += v;
+    out.push_back(prev);
+  }
+  if (!p.fresh.empty()) {
+    if (!p.fresh_sorted) {
+      std::sort(p.fresh.begin(), p.fresh.end());
+      p.fresh.erase(std::unique(p.fresh.begin(), p.fresh.end()), p.fresh.end());
+      p.fresh_sorted = true;
+    }
+    size_t mid = out.size();
+    out.insert(out.end(), p.fresh.begin(), p.fresh.end());
+    std::inplace_merge(out.begin(), out.begin() + mid, out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+  }
+  return out;
+}
+
+void SearchIndex::apply_upsert(const Question& q) {
+  std::u32string norm = normalize(q.text);
+  Doc d{q, to_utf8(norm)};
+  // Старые триграммы остаются в постингах: лишних кандидатов отсеет проверка по тексту
+  add_fresh(static_cast<uint32_t>(q.id), norm);
+  if (rebuilding_) changed_since_snapshot_.push_back(q.id);
+  docs_[q.id] = std::move(d);
+}
+
+void SearchIndex::add_fresh(uint32_t id, const std::u32string& norm) {
+  for (uint64_t g : trigrams(norm)) {
+    Postings& p = (*postings_)[g];
+    if (!p.fresh.empty() && p.fresh.back() >= id) p.fresh_sorted = false;
+    p.fresh.push_back(id);
+    ++fresh_total_;
+  }
+}
+
+void SearchIndex::stage_upsert(const Question& q) { staged_.push_back({Staged::Kind::Upsert, q}); }
+
+void SearchIndex::stage_remove(int question_id) {
+  Staged s{Staged::Kind::Remove, {}};
+  s.question.id = question_id;
+  staged_.push_back(s);
+}
+
+void SearchIndex::stage_remove_test(int test_id) {
+  Staged s{Staged::Kind::RemoveTest, {}};
+  s.question.test_id = test_id;
+  staged_.push_back(s);
+}
+
+void SearchIndex::discard_staged() { staged_.clear(); }
+
+void SearchIndex::commit_staged() {
+  adopt_background_rebuild();
+  for (const auto& s : staged_) {
+    switch (s.kind) {
+      case Staged::Kind::Upsert: apply_upsert(s.question); break;
+      case Staged::Kind::Remove: docs_.erase(s.question.id); break;
+      case Staged::Kind::RemoveTest:
+        // Каскадное удаление вопросов теста; удаление теста — редкая операция
+        for (auto it = docs_.begin(); it != docs_.end();) {
+          if (it->second.question.test_id == s.question.test_id) it = docs_.erase(it);
+          else ++it;
+        }
+        break;
+    }
+  }
+  staged_.clear();
+  // Накопилось много несжатых добавлений — пересобираем основную часть в фоне,
+  // запрос на запись её не ждёт
+  if (!rebuilding_ && fresh_total_ > std::max<size_t>(100000, docs_.size())) start_background_rebuild();
+}
+
+std::vector<SearchIndex::Hit> SearchIndex::search(const std::string& query, size_t limit, bool& min_length_error) const {
+  min_length_error = false;
+  std::u32string norm_query = normalize(query);
+  std::vector<uint64_t> grams = trigrams(norm_query);
+  if (grams.empty()) {
+    min_length_error = true;
+    return {};
+  }
+
+  // Пересечение от самых коротких списков к длинным
+  std::vector<std::vector<uint32_t>> lists;
+  lists.reserve(grams.size());
+  for (uint64_t g : grams) {
+    auto it = postings_->find(g);
+    if (it == postings_->end()) return {};
+    lists.push_back(decode(it->second));
+  }
+  std::sort(lists.begin(), lists.end(), [](const auto& a, const auto& b) { return a.size() < b.size(); });
+  std::vector<uint32_t> candidates = std::move(lists[0]);
+  for (size_t i = 1; i < lists.size() && !candidates.empty(); ++i) {
+    size_t n = intersect(candidates.data(), candidates.size(), lists[i].data(), lists[i].size(), candidates.data());
+    candidates.resize(n);
+  }
+
+  // Слова запроса для проверки и ранжирования
+  const std::string phrase = to_utf8(norm_query);
+  std::vector<std::string> words;
+  for (size_t i = 0; i < phrase.size();) {
+    size_t sp = phrase.find(' ', i);
+    if (sp == std::string::npos) sp = phrase.size();
+    words.push_back(phrase.substr(i, sp - i));
+    i = sp + 1;
+  }
+
+  std::vector<Hit> hits;
+  for (uint32_t id : candidates) {
+    auto it = docs_.find(static_cast<int>(id));
+    if (it == docs_.end()) continue;  // удалён после последней сборки
+    const std::string& text = it->second.norm;
+
+    size_t first_pos = std::string::npos;
+    bool all = true;
+    for (const auto& w : words) {
+      size_t pos = text.find(w);
+      if (pos == std::string::npos) { all = false; break; }
+      first_pos = std::min(first_pos, pos);
+    }
+    if (!all) continue;
+
+    // Фраза целиком, совпадение ближе к началу и короткие тексты — выше
+    double score = 1.0;
+    if (words.size() > 1 && text.find(phrase) != std::string::npos) score += 1.0;
+    if (first_pos == 0 || text[first_pos - 1] == ' ') score += 0.5;
+    score += 1.0 / (1.0 + first_pos / 32.0);
+    score += static_cast<double>(phrase.size()) / static_cast<double>(text.size());
+    hits.push_back(Hit{score, &it->second.question});
+  }
+
+  size_t top = std::min(limit, hits.size());
+  std::partial_sort(hits.begin(), hits.begin() + top, hits.end(), [](const Hit& a, const Hit& b) {
+    if (a.score != b.score) return a.score > b.score;
+    return a.question->id < b.question->id;
+  });
+  hits.resize(top);
+  return hits;
+}
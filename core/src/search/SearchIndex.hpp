@@ -0,0 +1,108 @@
+#pragma once
+#include "../models/Question.hpp"
+#include <cstddef>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Полнотекстовый индекс по банку вопросов в памяти core-api.
+//
+// Текст нормализуется (нижний регистр для латиницы и кириллицы, ё -> е,
+// остальное кроме букв и цифр — пробел) и режется на триграммы символов.
+// Постинги — отсортированные id вопросов: основная часть сжата
+// (дельты + varint), свежие изменения копятся несжатыми и периодически
+// вливаются в основную: сжатые постинги пересобираются в фоновом потоке по копии
+// текстов и подменяются указателем при следующем commit_staged(). Кандидаты — пересечение постингов (SSE2, если есть),
+// затем проверка подстрокой по актуальному тексту и ранжирование.
+//
+// Изменения из транзакций ставятся в очередь (stage_*) и применяются только
+// после commit, чтобы откат не оставлял в индексе несуществующих вопросов.
+class SearchIndex {
+public:
+  SearchIndex();
+  ~SearchIndex();
+  SearchIndex(const SearchIndex&) = delete;
+  SearchIndex& operator=(const SearchIndex&) = delete;
+
+  struct Hit {
+    double score;
+    const Question* question;
+  };
+
+  // Полная перестройка, постинги строятся в threads потоках
+  void rebuild(std::vector<Question> questions, unsigned threads);
+
+  void stage_upsert(const Question& q);
+  void stage_remove(int question_id);
+  void stage_remove_test(int test_id);
+  void commit_staged();
+  void discard_staged();
+
+  // Пустой результат и min_length_error=true, если в запросе нет слова из 3+ символов
+  std::vector<Hit> search(const std::string& query, size_t limit, bool& min_length_error) const;
+
+  size_t size() const { return docs_.size(); }
+
+  // Выбрасывает отложенные изменения при выходе из области, если commit_staged()
+  // не был вызван: откат или исключение не должны оставлять их следующей записи
+  class StagedGuard {
+  public:
+    explicit StagedGuard(SearchIndex* index) : index_(index) {}
+    ~StagedGuard() { if (index_) index_->discard_staged(); }
+    StagedGuard(const StagedGuard&) = delete;
+    StagedGuard& operator=(const StagedGuard&) = delete;
+
+  private:
+    SearchIndex* index_;
+  };
+
+  // Нормализованный текст (UTF-8 -> кодовые точки)
+  static std::u32string normalize(const std::string& text);
+
+private:
+  struct Doc {
+    Question question;
+    std::string norm;  // нормализованный текст в UTF-8 для проверки подстрокой
+  };
+  struct Postings {
+    std::vector<uint8_t> packed;  // дельты varint, по возрастанию id
+    uint32_t packed_count = 0;
+    mutable std::vector<uint32_t> fresh;  // добавления после последней сборки
+    mutable bool fresh_sorted = true;
+  };
+  using PostingsMap = std::unordered_map<uint64_t, Postings>;
+  struct Staged {
+    enum class Kind { Upsert, Remove, RemoveTest } kind;
+    Question question;
+  };
+
+  void apply_upsert(const Question& q);
+  void add_fresh(uint32_t id, const std::u32string& norm);
+  void build_postings(unsigned threads);
+  // Сжатые постинги по текстам, отсортированным по id; norms (если задан) получает
+  // нормализованный текст каждого документа
+  static std::unique_ptr<PostingsMap> pack_postings(const std::vector<std::pair<uint32_t, const std::string*>>& texts,
+                                                    unsigned threads, std::vector<std::string>* norms);
+  void start_background_rebuild();
+  void adopt_background_rebuild();
+  void join_background();
+  std::vector<uint32_t> decode(const Postings& p) const;
+
+  std::unordered_map<int, Doc> docs_;
+  std::unique_ptr<PostingsMap> postings_;
+  std::vector<Staged> staged_;
+  size_t fresh_total_ = 0;
+
+  // Фоновая пересборка: поток пишет только rebuilt_ и флаг готовности; всё остальное —
+  // поток сервера. Вопросы, изменённые после снимка текстов, снова попадают в свежие
+  // постинги при подмене. Тот же поток затем освобождает старую карту
+  std::thread background_;
+  std::unique_ptr<PostingsMap> rebuilt_;
+  std::atomic<bool> rebuilt_ready_{false};
+  bool rebuilding_ = false;
+  std::vector<int> changed_since_snapshot_;
+};
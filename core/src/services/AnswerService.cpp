@@ -4,7 +4,14 @@
 AnswerService::AnswerService(Database& db) : db_(db) {}
 
 std::vector<Answer> AnswerService::list_by_question(int question_id) {
-  pqxx::work tx{db_.connection()};
+  Database::Timer db_timer("AnswerService::list_by_question");
+  pqxx::work tx{db_.read_connection()};
+  auto result = list_by_question(tx, question_id);
+  tx.commit();
+  return result;
+}
+
+std::vector<Answer> AnswerService::list_by_question(pqxx::work& tx, int question_id) {
   auto r = tx.exec_params(
     "SELECT id, question_id, text, is_correct FROM answers WHERE question_id=$1 ORDER BY id ASC",
     question_id
@@ -20,12 +27,12 @@ std::vector<Answer> AnswerService::list_by_question(int question_id) {
     };
     out.push_back(std::move(a));
   }
-  tx.commit();
   return out;
 }
 
 std::optional<Answer> AnswerService::get(int id) {
-  pqxx::work tx{db_.connection()};
+  Database::Timer db_timer("AnswerService::get");
+  pqxx::work tx{db_.read_connection()};
   auto r = tx.exec_params(
     "SELECT id, question_id, text, is_correct FROM answers WHERE id=$1 LIMIT 1",
     id
@@ -43,20 +50,37 @@ std::optional<Answer> AnswerService::get(int id) {
 }
 
 int AnswerService::create(int question_id, const std::string& text, bool is_correct) {
+  Database::Timer db_timer("AnswerService::create");
   pqxx::work tx{db_.connection()};
+  int result = create(tx, question_id, text, is_correct);
+  tx.commit();
+  db_.note_write();
+  return result;
+}
+
+int AnswerService::create(pqxx::work& tx, int question_id, const std::string& text, bool is_correct) {
   auto r = tx.exec_params(
     "INSERT INTO answers (question_id, text, is_correct) VALUES ($1,$2,$3) RETURNING id",
     question_id, text, is_correct
   );
   int id = r[0]["id"].as<int>();
-  tx.commit();
   return id;
 }
 
 bool AnswerService::update(int id,
                            const std::optional<std::string>& text,
                            const std::optional<bool>& is_correct) {
+  Database::Timer db_timer("AnswerService::update");
   pqxx::work tx{db_.connection()};
+  bool result = update(tx, id, text, is_correct);
+  tx.commit();
+  db_.note_write();
+  return result;
+}
+
+bool AnswerService::update(pqxx::work& tx, int id,
+                           const std::optional<std::string>& text,
+                           const std::optional<bool>& is_correct) {
   std::string q = "UPDATE answers SET ";
   bool first = true;
   auto addField = [&](const std::string& f) {
@@ -71,13 +95,19 @@ bool AnswerService::update(int id,
 
   if (first) return false;
   auto res = tx.exec(q);
-  tx.commit();
   return res.affected_rows() > 0;
 }
 
 bool AnswerService::remove(int id) {
+  Database::Timer db_timer("AnswerService::remove");
   pqxx::work tx{db_.connection()};
-  auto res = tx.exec_params("DELETE FROM answers WHERE id=$1", id);
+  bool result = remove(tx, id);
   tx.commit();
+  db_.note_write();
+  return result;
+}
+
+bool AnswerService::remove(pqxx::work& tx, int id) {
+  auto res = tx.exec_params("DELETE FROM answers WHERE id=$1", id);
   return res.affected_rows() > 0;
 }
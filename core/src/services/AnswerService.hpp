@@ -18,6 +18,14 @@ public:
               const std::optional<bool>& is_correct);
   bool remove(int id);
 
+  // Те же операции в транзакции вызывающего (пакетные запросы, чтение с primary): commit делает он
+  std::vector<Answer> list_by_question(pqxx::work& tx, int question_id);
+  int create(pqxx::work& tx, int question_id, const std::string& text, bool is_correct);
+  bool update(pqxx::work& tx, int id,
+              const std::optional<std::string>& text,
+              const std::optional<bool>& is_correct);
+  bool remove(pqxx::work& tx, int id);
+
 private:
   Database& db_;
 };
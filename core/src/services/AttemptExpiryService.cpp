@@ -0,0 +1,72 @@
+#include "AttemptExpiryService.hpp"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <pqxx/pqxx>
+
+namespace {
+constexpr size_t kExpireBatch = 1000;
+}
+
+AttemptExpiryService::AttemptExpiryService(Database& db) : db_(db), wheel_(now_s()) {}
+
+int64_t AttemptExpiryService::now_s() {
+  using namespace std::chrono;
+  return duration_cast<seconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+size_t AttemptExpiryService::load_active() {
+  Database::Timer db_timer("AttemptExpiryService::load_active");
+  pqxx::work tx{db_.connection()};
+  // Оставшееся время считает БД, чтобы не зависеть от часовых поясов started_at
+  auto r = tx.exec(
+    "SELECT a.id, CEIL(EXTRACT(EPOCH FROM a.started_at + t.time_limit_minutes * INTERVAL '1 minute' - NOW()))::bigint "
+    "FROM attempts a JOIN tests t ON t.id = a.test_id "
+    "WHERE a.status = 'in_progress' AND t.time_limit_minutes IS NOT NULL"
+  );
+  tx.commit();
+  for (const auto& row : r) track(row[0].as<int>(), row[1].as<int64_t>());
+  return r.size();
+}
+
+void AttemptExpiryService::track(int attempt_id, int64_t remaining_s) {
+  wheel_.schedule(attempt_id, now_s() + remaining_s);
+}
+
+void AttemptExpiryService::finish(int attempt_id) {
+  wheel_.cancel(attempt_id);
+}
+
+size_t AttemptExpiryService::tick() {
+  std::vector<int> due = wheel_.advance(now_s());
+  if (due.empty()) return 0;
+  for (size_t i = 0; i < due.size(); i += kExpireBatch) {
+    std::vector<int> batch(due.begin() + i, due.begin() + std::min(due.size(), i + kExpireBatch));
+    expire(batch);
+  }
+  return due.size();
+}
+
+void AttemptExpiryService::expire(const std::vector<int>& ids) {
+  std::string array = "{";
+  for (size_t i = 0; i < ids.size(); ++i) {
+    if (i) array += ",";
+    array += std::to_string(ids[i]);
+  }
+  array += "}";
+  try {
+    Database::Timer db_timer("AttemptExpiryService::expire");
+    pqxx::work tx{db_.connection()};
+    // status в условии: попытку могли завершить в обход этого процесса
+    tx.exec_params(
+      "UPDATE attempts SET status = 'expired', finished_at = NOW() "
+      "WHERE id = ANY($1::int[]) AND status = 'in_progress'",
+      array
+    );
+    tx.commit();
+  } catch (const std::exception& e) {
+    // БД недоступна — вернём в колесо и попробуем через секунду
+    std::cerr << "attempt expiry failed: " << e.what() << std::endl;
+    for (int id : ids) wheel_.schedule(id, now_s() + 1);
+  }
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include "../database/Database.hpp"
+#include "../timer/TimerWheel.hpp"
+#include <cstdint>
+#include <vector>
+
+// Истечение попыток по tests.time_limit_minutes.
+// Активные попытки держатся в колесе таймеров: загружаются при старте,
+// добавляются при создании попытки, снимаются при завершении. Сработавшие
+// переводятся в status='expired' пакетными UPDATE — без периодического
+// сканирования attempts.
+class AttemptExpiryService {
+public:
+  explicit AttemptExpiryService(Database& db);
+
+  // Загружает in_progress-попытки тестов с ограничением времени; возвращает их число
+  size_t load_active();
+
+  // Попытка закончится через remaining_s секунд от текущего момента
+  void track(int attempt_id, int64_t remaining_s);
+  void finish(int attempt_id);
+
+  // Вызывается из цикла сервера (не реже раза в секунду); возвращает число истёкших
+  size_t tick();
+
+  size_t active() const { return wheel_.size(); }
+
+private:
+  static int64_t now_s();
+  void expire(const std::vector<int>& ids);
+
+  Database& db_;
+  TimerWheel wheel_;
+};
@@ -0,0 +1,184 @@
+#include "BatchService.hpp"
+#include "../http/Json.hpp"
+#include <cctype>
+#include <optional>
+#include <vector>
+
+namespace {
+
+std::vector<std::string> split_path(const std::string& path) {
+  std::vector<std::string> parts;
+  size_t i = 1;
+  while (i <= path.size()) {
+    size_t slash = path.find('/', i);
+    if (slash == std::string::npos) slash = path.size();
+    parts.push_back(path.substr(i, slash - i));
+    i = slash + 1;
+  }
+  return parts;
+}
+
+std::optional<int> to_id(const std::string& s) {
+  if (s.empty() || s.size() > 9 || s.find_first_not_of("0123456789") != std::string::npos) return std::nullopt;
+  return std::stoi(s);
+}
+
+// Поля тела операции
+std::optional<std::string> str_field(const std::map<std::string, std::string>& f, const char* name) {
+  auto it = f.find(name);
+  return it == f.end() ? std::nullopt : http::json_unquote(it->second);
+}
+
+std::optional<int> int_field(const std::map<std::string, std::string>& f, const char* name) {
+  auto it = f.find(name);
+  if (it == f.end()) return std::nullopt;
+  try { return std::stoi(it->second); } catch (...) { return std::nullopt; }
+}
+
+std::optional<bool> bool_field(const std::map<std::string, std::string>& f, const char* name) {
+  auto it = f.find(name);
+  if (it == f.end()) return std::nullopt;
+  if (it->second == "true") return true;
+  if (it->second == "false") return false;
+  return std::nullopt;
+}
+
+std::string message(const char* text) { return std::string("{\"message\":\"") + text + "\"}"; }
+
+} // namespace
+
+BatchService::BatchService(Database& db, TestService& tests, QuestionService& questions, AnswerService& answers,
+                           size_t max_operations)
+  : db_(db), tests_(tests), questions_(questions), answers_(answers), max_operations_(max_operations) {}
+
+BatchService::OpResult BatchService::run_one(pqxx::work& tx, const std::string& method, const std::string& path,
+                                             const std::string& body) {
+  auto f = http::json_object_fields(body.empty() ? "{}" : body);
+  auto p = split_path(path);
+  auto created = [](int id) { return OpResult{201, "{\"id\":" + std::to_string(id) + "}", id}; };
+  auto done = [](bool ok, const char* ok_msg, const char* missing_msg) {
+    return ok ? OpResult{200, message(ok_msg), 0} : OpResult{404, message(missing_msg), 0};
+  };
+
+  // /tests, /tests/{id}, /tests/{id}/questions
+  if (p.size() >= 1 && p[0] == "tests") {
+    if (p.size() == 1 && method == "POST") {
+      return created(tests_.create(tx, str_field(f, "title").value_or("Untitled"), str_field(f, "description")));
+    }
+    auto id = p.size() >= 2 ? to_id(p[1]) : std::nullopt;
+    if (id && p.size() == 2 && method == "PUT") {
+      return done(tests_.update(tx, *id, str_field(f, "title"), str_field(f, "description"), bool_field(f, "is_published")),
+                  "Test updated", "Test not found");
+    }
+    if (id && p.size() == 2 && method == "DELETE") {
+      bool removed = tests_.remove(tx, *id);
+      if (removed) removed_tests_.push_back(*id);
+      return done(removed, "Test deleted", "Test not found");
+    }
+    if (id && p.size() == 3 && p[2] == "questions" && method == "POST") {
+      return created(questions_.create(tx, *id, str_field(f, "text").value_or("Question"),
+                                       str_field(f, "type").value_or("single"), int_field(f, "order_index").value_or(1)));
+    }
+  }
+  // /questions/{id}, /questions/{id}/answers
+  if (p.size() >= 2 && p[0] == "questions") {
+    auto id = to_id(p[1]);
+    if (id && p.size() == 2 && method == "PUT") {
+      return done(questions_.update(tx, *id, str_field(f, "text"), str_field(f, "type"), int_field(f, "order_index")),
+                  "Question updated", "Question not found");
+    }
+    if (id && p.size() == 2 && method == "DELETE") {
+      return done(questions_.remove(tx, *id), "Question deleted", "Question not found");
+    }
+    if (id && p.size() == 3 && p[2] == "answers" && method == "POST") {
+      return created(answers_.create(tx, *id, str_field(f, "text").value_or("Answer"), bool_field(f, "is_correct").value_or(false)));
+    }
+  }
+  // /answers/{id}
+  if (p.size() == 2 && p[0] == "answers") {
+    auto id = to_id(p[1]);
+    if (id && method == "PUT") {
+      return done(answers_.update(tx, *id, str_field(f, "text"), bool_field(f, "is_correct")),
+                  "Answer updated", "Answer not found");
+    }
+    if (id && method == "DELETE") {
+      return done(answers_.remove(tx, *id), "Answer deleted", "Answer not found");
+    }
+  }
+  return OpResult{400, message("Unsupported batch operation"), 0};
+}
+
+BatchService::Result BatchService::execute(const std::string& body) {
+  auto top = http::json_object_fields(body);
+  auto ops_it = top.find("operations");
+  std::vector<std::string> ops;
+  if (ops_it != top.end()) ops = http::json_array_items(ops_it->second);
+  if (ops.empty()) {
+    return {400, "{\"code\":\"BAD_REQUEST\",\"message\":\"Expected non-empty \\\"operations\\\" array\"}"};
+  }
+  if (ops.size() > max_operations_) {
+    return {413, "{\"code\":\"TOO_MANY_OPERATIONS\",\"message\":\"At most " + std::to_string(max_operations_) +
+                 " operations per batch\"}"};
+  }
+
+  auto failed = [](size_t index, int status, const std::string& error) {
+    return Result{status, "{\"code\":\"BATCH_FAILED\",\"failed_index\":" + std::to_string(index) +
+                          ",\"status\":" + std::to_string(status) + ",\"error\":" + error + "}"};
+  };
+
+  Database::Timer db_timer("BatchService::execute");
+  pqxx::work tx{db_.connection()};
+  // При откате пакета отложенные изменения индекса поиска выбрасываются
+  SearchIndex::StagedGuard staged_guard{index_};
+  removed_tests_.clear();
+  std::vector<int> created_ids;
+  created_ids.reserve(ops.size());
+  std::string results = "[";
+
+  for (size_t i = 0; i < ops.size(); ++i) {
+    auto op = http::json_object_fields(ops[i]);
+    auto method = str_field(op, "method");
+    auto path = str_field(op, "path");
+    if (!method || !path || path->empty() || (*path)[0] != '/') {
+      return failed(i, 400, message("Operation needs \\\"method\\\" and \\\"path\\\""));
+    }
+
+    // Подстановка $N — id, созданного операцией N этого пакета
+    std::string resolved;
+    for (size_t k = 0; k < path->size(); ++k) {
+      char c = (*path)[k];
+      if (c != '$') { resolved += c; continue; }
+      size_t end = k + 1;
+      while (end < path->size() && std::isdigit(static_cast<unsigned char>((*path)[end]))) ++end;
+      auto ref = to_id(path->substr(k + 1, end - k - 1));
+      if (!ref || static_cast<size_t>(*ref) >= i || created_ids[*ref] == 0) {
+        return failed(i, 400, message("Bad reference to an earlier operation"));
+      }
+      resolved += std::to_string(created_ids[*ref]);
+      k = end - 1;
+    }
+
+    auto body_it = op.find("body");
+    OpResult r;
+    try {
+      r = run_one(tx, *method, resolved, body_it == op.end() ? "" : body_it->second);
+    } catch (const std::exception& e) {
+      // Нарушение ограничений БД и т.п.: транзакция уже непригодна, откатываем весь пакет
+      return failed(i, 409, "{\"message\":\"" + http::json_escape(e.what()) + "\"}");
+    }
+    if (r.status >= 300) return failed(i, r.status, r.body);
+
+    created_ids.push_back(r.created_id);
+    if (i) results += ",";
+    results += "{\"status\":" + std::to_string(r.status) + ",\"body\":" + r.body + "}";
+  }
+
+  tx.commit();
+  db_.note_write();
+  if (index_) index_->commit_staged();
+  if (snapshots_) {
+    for (int test_id : removed_tests_) snapshots_->remove(test_id);
+  }
+  results += "]";
+  return {200, "{\"results\":" + results + "}"};
+}
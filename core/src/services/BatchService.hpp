@@ -0,0 +1,49 @@
+#pragma once
+#include "../database/Database.hpp"
+#include "TestService.hpp"
+#include "QuestionService.hpp"
+#include "AnswerService.hpp"
+#include "SnapshotService.hpp"
+#include <string>
+
+// POST /batch: упорядоченный список изменений тестов/вопросов/ответов,
+// выполняемый через сервисы в одной транзакции.
+//
+// Тело: {"operations":[{"method":"POST","path":"/tests/5/questions","body":{...}}, ...]}
+// В path можно сослаться на id, созданный операцией N этого же пакета: "/questions/$1/answers".
+// Любая неуспешная операция откатывает весь пакет.
+class BatchService {
+public:
+  struct Result {
+    int status;        // HTTP-статус всего пакета
+    std::string body;  // JSON
+  };
+
+  BatchService(Database& db, TestService& tests, QuestionService& questions, AnswerService& answers,
+               size_t max_operations);
+
+  Result execute(const std::string& body);
+
+  // Индекс поиска: изменения вопросов из пакета применяются к нему только после commit
+  void attach_index(SearchIndex* index) { index_ = index; }
+  // Снимки удалённых пакетом тестов удаляются после commit
+  void attach_snapshots(SnapshotService* snapshots) { snapshots_ = snapshots; }
+
+private:
+  struct OpResult {
+    int status;
+    std::string body;
+    int created_id;  // 0 — операция ничего не создала
+  };
+
+  OpResult run_one(pqxx::work& tx, const std::string& method, const std::string& path, const std::string& body);
+
+  Database& db_;
+  TestService& tests_;
+  QuestionService& questions_;
+  AnswerService& answers_;
+  size_t max_operations_;
+  SearchIndex* index_ = nullptr;
+  SnapshotService* snapshots_ = nullptr;
+  std::vector<int> removed_tests_;  // тесты, удалённые текущим пакетом
+};
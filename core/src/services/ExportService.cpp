@@ -0,0 +1,214 @@
+#include "ExportService.hpp"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <libpq-fe.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr size_t kChunkBytes = 64 * 1024;
+
+// Все байты с MSG_NOSIGNAL: закрытый клиентом сокет — ошибка, а не SIGPIPE
+bool send_all(int fd, const char* data, size_t len) {
+  while (len > 0) {
+    ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    data += n;
+    len -= static_cast<size_t>(n);
+  }
+  return true;
+}
+
+// Кусок chunked-ответа: размер, данные и CRLF одним sendmsg
+bool send_chunk(int fd, const std::string& data) {
+  char head[16];
+  int head_len = std::snprintf(head, sizeof(head), "%zx\r\n", data.size());
+  struct iovec iov[3] = {
+    {head, static_cast<size_t>(head_len)},
+    {const_cast<char*>(data.data()), data.size()},
+    {const_cast<char*>("\r\n"), 2},
+  };
+  msghdr msg{};
+  msg.msg_iov = iov;
+  msg.msg_iovlen = 3;
+  size_t total = head_len + data.size() + 2;
+  ssize_t n;
+  do n = sendmsg(fd, &msg, MSG_NOSIGNAL); while (n < 0 && errno == EINTR);
+  if (n < 0) return false;
+  if (static_cast<size_t>(n) == total) return true;
+
+  // Частичная отправка: досылаем остаток обычным send
+  std::string rest(head, head_len);
+  rest += data;
+  rest += "\r\n";
+  return send_all(fd, rest.data() + n, rest.size() - static_cast<size_t>(n));
+}
+
+std::string simple_response(const char* status_line, const std::string& body) {
+  return std::string(status_line) + "\r\nContent-Type: application/json\r\nContent-Length: " +
+         std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+}
+
+std::string copy_query(int test_id, ExportService::Format format) {
+  const std::string select =
+    "SELECT a.id AS attempt_id, a.user_id, u.external_id, a.status, a.started_at, a.finished_at, a.score, a.answers "
+    "FROM attempts a LEFT JOIN users u ON u.id = a.user_id "
+    "WHERE a.test_id = " + std::to_string(test_id) + " ORDER BY a.id";
+  if (format == ExportService::Format::Csv) return "COPY (" + select + ") TO STDOUT WITH (FORMAT csv, HEADER)";
+  // row_to_json экранирует управляющие символы, поэтому с кавычкой и разделителем,
+  // которых в JSON не бывает, CSV-режим COPY отдаёт строки как есть (текстовый удвоил бы '\')
+  return "COPY (SELECT row_to_json(t) FROM (" + select + ") t) TO STDOUT "
+         "WITH (FORMAT csv, QUOTE E'\\x01', DELIMITER E'\\x02')";
+}
+
+} // namespace
+
+ExportService::ExportService(Database& db, unsigned max_concurrent, int send_timeout_s)
+  : db_(db), max_concurrent_(max_concurrent), send_timeout_s_(send_timeout_s) {}
+
+std::optional<ExportService::Format> ExportService::parse_format(const std::string& name) {
+  if (name == "csv") return Format::Csv;
+  if (name == "ndjson") return Format::Ndjson;
+  return std::nullopt;
+}
+
+bool ExportService::start(int fd, int test_id, int user_id, Format format, DoneCallback on_done) {
+  unsigned current = running_.load(std::memory_order_relaxed);
+  do {
+    if (current >= max_concurrent_) return false;
+  } while (!running_.compare_exchange_weak(current, current + 1, std::memory_order_acq_rel));
+
+  // Выгрузка только читает — подходит и реплика
+  std::string conn_str = db_.read_connection_string();
+  int send_timeout_s = send_timeout_s_;
+  std::thread([this, fd, conn_str = std::move(conn_str), test_id, user_id, format, send_timeout_s,
+               on_done = std::move(on_done)] {
+    uint64_t bytes = 0;
+    int status = 500;
+    try {
+      run(fd, conn_str, test_id, user_id, format, send_timeout_s, bytes, status);
+    } catch (const std::exception& e) {
+      std::cerr << "export of test " << test_id << " failed: " << e.what() << std::endl;
+    }
+    close(fd);
+    // Колбэк до уменьшения счётчика: main ждёт running() == 0 перед выходом
+    if (on_done) on_done(status, bytes);
+    running_.fetch_sub(1, std::memory_order_acq_rel);
+  }).detach();
+  return true;
+}
+
+void ExportService::run(int fd, std::string conn_str, int test_id, int user_id, Format format, int send_timeout_s,
+                        uint64_t& bytes, int& status) {
+  // Клиент, переставший читать, не должен держать поток и соединение с БД вечно
+  timeval tv{send_timeout_s, 0};
+  setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+  auto reply = [&](const char* status_line, const std::string& body) {
+    std::string response = simple_response(status_line, body);
+    status = std::atoi(status_line + 9);
+    if (send_all(fd, response.data(), response.size())) bytes += response.size();
+  };
+
+  PGconn* conn = PQconnectdb(conn_str.c_str());
+  if (PQstatus(conn) != CONNECTION_OK) {
+    std::cerr << "export: " << PQerrorMessage(conn);
+    PQfinish(conn);
+    reply("HTTP/1.1 503 Service Unavailable", "{\"code\":\"DB_UNAVAILABLE\",\"message\":\"Database unavailable\"}");
+    return;
+  }
+
+  std::string id = std::to_string(test_id);
+  const char* params[1] = {id.c_str()};
+  // Попытки содержат ответы всех пользователей — выгружает только автор теста
+  PGresult* test = PQexecParams(conn, "SELECT author_id FROM tests WHERE id = $1", 1, nullptr, params, nullptr, nullptr, 0);
+  bool found = PQresultStatus(test) == PGRES_TUPLES_OK && PQntuples(test) > 0;
+  bool is_author = found && !PQgetisnull(test, 0, 0) && std::atoi(PQgetvalue(test, 0, 0)) == user_id;
+  PQclear(test);
+  if (!found) {
+    PQfinish(conn);
+    reply("HTTP/1.1 404 Not Found", "{\"message\":\"Test not found\"}");
+    return;
+  }
+  if (!is_author) {
+    PQfinish(conn);
+    reply("HTTP/1.1 403 Forbidden", "{\"code\":\"FORBIDDEN\",\"message\":\"Only the test author can export attempts\"}");
+    return;
+  }
+
+  PGresult* copy = PQexec(conn, copy_query(test_id, format).c_str());
+  bool copying = PQresultStatus(copy) == PGRES_COPY_OUT;
+  if (!copying) std::cerr << "export: " << PQresultErrorMessage(copy);
+  PQclear(copy);
+  if (!copying) {
+    PQfinish(conn);
+    reply("HTTP/1.1 500 Internal Server Error", "{\"code\":\"DB_ERROR\",\"message\":\"Export query failed\"}");
+    return;
+  }
+
+  const bool csv = format == Format::Csv;
+  std::string head = "HTTP/1.1 200 OK\r\n";
+  head += csv ? "Content-Type: text/csv; charset=utf-8\r\n" : "Content-Type: application/x-ndjson\r\n";
+  head += "Content-Disposition: attachment; filename=\"test_" + id + "_attempts." + (csv ? "csv" : "ndjson") + "\"\r\n";
+  head += "Transfer-Encoding: chunked\r\nConnection: close\r\n\r\n";
+  status = 200;
+  bool client_ok = send_all(fd, head.data(), head.size());
+  if (client_ok) bytes += head.size();
+
+  // Строки COPY копятся в буфер ~64 КБ и уходят одним куском chunked-ответа
+  std::string chunk;
+  chunk.reserve(kChunkBytes + 4096);
+  char* row = nullptr;
+  int len;
+  while (client_ok && (len = PQgetCopyData(conn, &row, 0)) > 0) {
+    chunk.append(row, static_cast<size_t>(len));
+    PQfreemem(row);
+    if (chunk.size() >= kChunkBytes) {
+      client_ok = send_chunk(fd, chunk);
+      if (client_ok) bytes += chunk.size();
+      chunk.clear();
+    }
+  }
+
+  if (!client_ok) {
+    // Клиент ушёл: закрытие соединения прерывает COPY на сервере БД
+    PQfinish(conn);
+    status = 499;
+    return;
+  }
+
+  bool copy_ok = len == -1;
+  if (copy_ok) {
+    PGresult* res = PQgetResult(conn);
+    copy_ok = PQresultStatus(res) == PGRES_COMMAND_OK;
+    if (!copy_ok) std::cerr << "export: " << PQresultErrorMessage(res);
+    PQclear(res);
+  }
+  PQfinish(conn);
+
+  // Без завершающего нулевого куска клиент увидит оборванную передачу, а не неполный файл
+  if (!copy_ok) {
+    status = 500;
+    return;
+  }
+  // Хвост не ушёл — без завершающего куска, иначе клиент примет обрезанный файл за полный
+  if (!chunk.empty()) {
+    if (!send_chunk(fd, chunk)) {
+      status = 499;
+      return;
+    }
+    bytes += chunk.size();
+  }
+  if (!send_all(fd, "0\r\n\r\n", 5)) {
+    status = 499;
+    return;
+  }
+  bytes += 5;
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include "../database/Database.hpp"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+
+// Потоковая выгрузка попыток теста: GET /tests/{id}/attempts/export?format=csv|ndjson.
+//
+// Данные идут из COPY (...) TO STDOUT прямо в сокет клиента кусками
+// chunked-ответа: память постоянна при любом числе строк, а блокирующая
+// отправка даёт обратное давление — медленный клиент притормаживает COPY.
+// Каждая выгрузка работает в своём потоке на отдельном соединении libpq,
+// чтобы длинная передача не держала цикл сервера.
+class ExportService {
+public:
+  enum class Format { Csv, Ndjson };
+
+  // Вызывается из потока выгрузки по её окончании: HTTP-статус и отправленные байты
+  using DoneCallback = std::function<void(int status, uint64_t bytes)>;
+
+  ExportService(Database& db, unsigned max_concurrent, int send_timeout_s);
+
+  static std::optional<Format> parse_format(const std::string& name);
+
+  // Запускает выгрузку от имени user_id (выгружать может только автор теста, иначе 403);
+  // сокет переходит во владение её потока.
+  // false — лимит одновременных выгрузок исчерпан, сокет остаётся у вызывающего.
+  bool start(int fd, int test_id, int user_id, Format format, DoneCallback on_done);
+
+  unsigned running() const { return running_.load(std::memory_order_relaxed); }
+
+private:
+  static void run(int fd, std::string conn_str, int test_id, int user_id, Format format, int send_timeout_s,
+                  uint64_t& bytes, int& status);
+
+  Database& db_;
+  unsigned max_concurrent_;
+  int send_timeout_s_;
+  std::atomic<unsigned> running_{0};
+};
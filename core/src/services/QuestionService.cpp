@@ -4,7 +4,14 @@
 QuestionService::QuestionService(Database& db) : db_(db) {}
 
 std::vector<Question> QuestionService::list_by_test(int test_id) {
-  pqxx::work tx{db_.connection()};
+  Database::Timer db_timer("QuestionService::list_by_test");
+  pqxx::work tx{db_.read_connection()};
+  auto result = list_by_test(tx, test_id);
+  tx.commit();
+  return result;
+}
+
+std::vector<Question> QuestionService::list_by_test(pqxx::work& tx, int test_id) {
   auto r = tx.exec_params(
     "SELECT id, test_id, text, type, order_index FROM questions WHERE test_id=$1 ORDER BY order_index ASC, id ASC",
     test_id
@@ -21,12 +28,32 @@ std::vector<Question> QuestionService::list_by_test(int test_id) {
     };
     out.push_back(std::move(q));
   }
+  return out;
+}
+
+std::vector<Question> QuestionService::list_all() {
+  Database::Timer db_timer("QuestionService::list_all");
+  pqxx::work tx{db_.read_connection()};
+  auto r = tx.exec("SELECT id, test_id, text, type, order_index FROM questions ORDER BY id");
+  std::vector<Question> out;
+  out.reserve(r.size());
+  for (const auto& row : r) {
+    Question q {
+      row["id"].as<int>(),
+      row["test_id"].as<int>(),
+      row["text"].as<std::string>(),
+      row["type"].as<std::string>(),
+      row["order_index"].as<int>()
+    };
+    out.push_back(std::move(q));
+  }
   tx.commit();
   return out;
 }
 
 std::optional<Question> QuestionService::get(int id) {
-  pqxx::work tx{db_.connection()};
+  Database::Timer db_timer("QuestionService::get");
+  pqxx::work tx{db_.read_connection()};
   auto r = tx.exec_params(
     "SELECT id, test_id, text, type, order_index FROM questions WHERE id=$1 LIMIT 1",
     id
@@ -45,13 +72,23 @@ std::optional<Question> QuestionService::get(int id) {
 }
 
 int QuestionService::create(int test_id, const std::string& text, const std::string& type, int order_index) {
+  Database::Timer db_timer("QuestionService::create");
+  SearchIndex::StagedGuard staged_guard{index_};
   pqxx::work tx{db_.connection()};
+  int result = create(tx, test_id, text, type, order_index);
+  tx.commit();
+  db_.note_write();
+  if (index_) index_->commit_staged();
+  return result;
+}
+
+int QuestionService::create(pqxx::work& tx, int test_id, const std::string& text, const std::string& type, int order_index) {
   auto r = tx.exec_params(
     "INSERT INTO questions (test_id, text, type, order_index) VALUES ($1,$2,$3,$4) RETURNING id",
     test_id, text, type, order_index
   );
   int id = r[0]["id"].as<int>();
-  tx.commit();
+  if (index_) index_->stage_upsert(Question{id, test_id, text, type, order_index});
   return id;
 }
 
@@ -59,7 +96,20 @@ bool QuestionService::update(int id,
                              const std::optional<std::string>& text,
                              const std::optional<std::string>& type,
                              const std::optional<int>& order_index) {
+  Database::Timer db_timer("QuestionService::update");
+  SearchIndex::StagedGuard staged_guard{index_};
   pqxx::work tx{db_.connection()};
+  bool result = update(tx, id, text, type, order_index);
+  tx.commit();
+  db_.note_write();
+  if (index_) index_->commit_staged();
+  return result;
+}
+
+bool QuestionService::update(pqxx::work& tx, int id,
+                             const std::optional<std::string>& text,
+                             const std::optional<std::string>& type,
+                             const std::optional<int>& order_index) {
   std::string q = "UPDATE questions SET ";
   bool first = true;
   auto addField = [&](const std::string& f) {
@@ -72,16 +122,38 @@ bool QuestionService::update(int id,
   if (type.has_value())        addField("type = " + tx.quote(*type));
   if (order_index.has_value()) addField("order_index = " + tx.quote(*order_index));
   q += " WHERE id = " + tx.quote(id);
+  q += " RETURNING id, test_id, text, type, order_index";
 
   if (first) return false; // ничего не обновили
   auto res = tx.exec(q);
-  tx.commit();
-  return res.affected_rows() > 0;
+  if (res.empty()) return false;
+  if (index_) {
+    const auto& row = res[0];
+    index_->stage_upsert(Question{
+      row["id"].as<int>(),
+      row["test_id"].as<int>(),
+      row["text"].as<std::string>(),
+      row["type"].as<std::string>(),
+      row["order_index"].as<int>()
+    });
+  }
+  return true;
 }
 
 bool QuestionService::remove(int id) {
+  Database::Timer db_timer("QuestionService::remove");
+  SearchIndex::StagedGuard staged_guard{index_};
   pqxx::work tx{db_.connection()};
-  auto res = tx.exec_params("DELETE FROM questions WHERE id=$1", id);
+  bool result = remove(tx, id);
   tx.commit();
-  return res.affected_rows() > 0;
+  db_.note_write();
+  if (index_) index_->commit_staged();
+  return result;
+}
+
+bool QuestionService::remove(pqxx::work& tx, int id) {
+  auto res = tx.exec_params("DELETE FROM questions WHERE id=$1", id);
+  if (res.affected_rows() == 0) return false;
+  if (index_) index_->stage_remove(id);
+  return true;
 }
@@ -1,6 +1,7 @@
 #pragma once
 #include "../database/Database.hpp"
 #include "../models/Question.hpp"
+#include "../search/SearchIndex.hpp"
 #include <vector>
 #include <optional>
 #include <string>
@@ -9,8 +10,13 @@ class QuestionService {
 public:
   explicit QuestionService(Database& db);
 
+  // Индекс поиска, который обновляется вместе с изменениями вопросов (может не быть)
+  void attach_index(SearchIndex* index) { index_ = index; }
+
   // CRUD
   std::vector<Question> list_by_test(int test_id);
+  // Весь банк вопросов — для построения индекса поиска при старте
+  std::vector<Question> list_all();
   std::optional<Question> get(int id);
   int create(int test_id, const std::string& text, const std::string& type, int order_index);
   bool update(int id,
@@ -19,6 +25,16 @@ public:
               const std::optional<int>& order_index);
   bool remove(int id);
 
+  // Те же операции в транзакции вызывающего (пакетные запросы, чтение с primary): commit делает он
+  std::vector<Question> list_by_test(pqxx::work& tx, int test_id);
+  int create(pqxx::work& tx, int test_id, const std::string& text, const std::string& type, int order_index);
+  bool update(pqxx::work& tx, int id,
+              const std::optional<std::string>& text,
+              const std::optional<std::string>& type,
+              const std::optional<int>& order_index);
+  bool remove(pqxx::work& tx, int id);
+
 private:
   Database& db_;
+  SearchIndex* index_ = nullptr;
 };
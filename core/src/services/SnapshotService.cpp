@@ -0,0 +1,76 @@
+#include "SnapshotService.hpp"
+#include <cstdio>
+#include <iostream>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+SnapshotService::SnapshotService(Database& db, TestService& tests, QuestionService& questions, AnswerService& answers,
+                                 std::string dir)
+  : db_(db), tests_(tests), questions_(questions), answers_(answers), dir_(std::move(dir)) {
+  ::mkdir(dir_.c_str(), 0755);
+}
+
+std::string SnapshotService::path_for(int test_id) const {
+  return dir_ + "/test_" + std::to_string(test_id) + ".snap";
+}
+
+size_t SnapshotService::load_all() {
+  DIR* d = ::opendir(dir_.c_str());
+  if (!d) return 0;
+  while (dirent* e = ::readdir(d)) {
+    int test_id = 0;
+    char tail[8] = {0};
+    // Ровно test_<id>.snap — недописанные *.snap.tmp пропускаем
+    if (std::sscanf(e->d_name, "test_%d.%7s", &test_id, tail) != 2 || std::string(tail) != "snap") continue;
+    try {
+      loaded_[test_id] = std::make_unique<snapshot::MappedSnapshot>(dir_ + "/" + e->d_name);
+    } catch (const std::exception& ex) {
+      std::cerr << "snapshot " << e->d_name << " skipped: " << ex.what() << std::endl;
+    }
+  }
+  ::closedir(d);
+  return loaded_.size();
+}
+
+const snapshot::MappedSnapshot* SnapshotService::compile(int test_id, CompileStatus& status) {
+  // Снимок неизменяем, поэтому читаем с primary и одной транзакцией: отстающая
+  // реплика не должна навсегда попасть в сохранённый снимок
+  Database::Timer db_timer("SnapshotService::compile");
+  pqxx::work tx{db_.connection()};
+  auto test = tests_.get(tx, test_id);
+  if (!test) {
+    status = CompileStatus::NotFound;
+    return nullptr;
+  }
+  // В снимок попадают только опубликованные тесты
+  if (!test->is_published) {
+    status = CompileStatus::NotPublished;
+    return nullptr;
+  }
+
+  auto questions = questions_.list_by_test(tx, test_id);
+  std::vector<std::vector<Answer>> answers;
+  answers.reserve(questions.size());
+  for (const auto& q : questions) answers.push_back(answers_.list_by_question(tx, q.id));
+  tx.commit();
+
+  std::string path = path_for(test_id);
+  snapshot::write_file(path, snapshot::compile(*test, questions, answers));
+  auto& slot = loaded_[test_id];
+  slot = std::make_unique<snapshot::MappedSnapshot>(path);
+  status = CompileStatus::Ok;
+  if (on_change_) on_change_(test_id);
+  return slot.get();
+}
+
+void SnapshotService::remove(int test_id) {
+  loaded_.erase(test_id);  // munmap в деструкторе MappedSnapshot
+  ::unlink(path_for(test_id).c_str());
+  if (on_change_) on_change_(test_id);
+}
+
+const snapshot::MappedSnapshot* SnapshotService::find(int test_id) const {
+  auto it = loaded_.find(test_id);
+  return it == loaded_.end() ? nullptr : it->second.get();
+}
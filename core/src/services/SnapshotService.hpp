@@ -0,0 +1,47 @@
+#pragma once
+#include "TestService.hpp"
+#include "QuestionService.hpp"
+#include "AnswerService.hpp"
+#include "../snapshot/TestSnapshot.hpp"
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+
+// Компиляция опубликованных тестов в бинарные снимки и их хранение.
+// Снимки лежат в каталоге dir как test_<id>.snap и отображаются в память,
+// поэтому после перезапуска горячие тесты отдаются без запросов к БД.
+class SnapshotService {
+public:
+  SnapshotService(Database& db, TestService& tests, QuestionService& questions, AnswerService& answers,
+                  std::string dir);
+
+  // Подхватывает все снимки из каталога; возвращает число загруженных.
+  size_t load_all();
+
+  enum class CompileStatus { Ok, NotFound, NotPublished };
+
+  // Собирает снимок опубликованного теста из БД и заменяет текущий.
+  // nullptr — теста нет или он не опубликован (см. status).
+  const snapshot::MappedSnapshot* compile(int test_id, CompileStatus& status);
+
+  // nullptr, если снимок не собран.
+  const snapshot::MappedSnapshot* find(int test_id) const;
+
+  // Тест удалён: снимок выгружается из памяти и удаляется с диска
+  void remove(int test_id);
+
+  // Вызывается после пересборки или удаления снимка (сброс кэша ответов)
+  void set_on_change(std::function<void(int test_id)> on_change) { on_change_ = std::move(on_change); }
+
+private:
+  std::string path_for(int test_id) const;
+
+  Database& db_;
+  TestService& tests_;
+  QuestionService& questions_;
+  AnswerService& answers_;
+  std::string dir_;
+  std::map<int, std::unique_ptr<snapshot::MappedSnapshot>> loaded_;
+  std::function<void(int)> on_change_;
+};
@@ -4,7 +4,8 @@
 TestService::TestService(Database& db) : db_(db) {}
 
 std::vector<Test> TestService::list() {
-  pqxx::work tx{db_.connection()};
+  Database::Timer db_timer("TestService::list");
+  pqxx::work tx{db_.read_connection()};
   auto r = tx.exec("SELECT id, title, description, author_id, is_published FROM tests ORDER BY id ASC");
   std::vector<Test> out;
   out.reserve(r.size());
@@ -22,7 +23,14 @@ std::vector<Test> TestService::list() {
 }
 
 std::optional<Test> TestService::get(int id) {
-  pqxx::work tx{db_.connection()};
+  Database::Timer db_timer("TestService::get");
+  pqxx::work tx{db_.read_connection()};
+  auto result = get(tx, id);
+  tx.commit();
+  return result;
+}
+
+std::optional<Test> TestService::get(pqxx::work& tx, int id) {
   auto r = tx.exec_params(
     "SELECT id, title, description, author_id, is_published FROM tests WHERE id = $1 LIMIT 1", id
   );
@@ -34,12 +42,19 @@ std::optional<Test> TestService::get(int id) {
   t.description = row["description"].is_null() ? std::optional<std::string>{} : std::make_optional(row["description"].c_str());
   t.author_id = row["author_id"].is_null() ? std::optional<int>{} : std::make_optional(row["author_id"].as<int>());
   t.is_published = row["is_published"].as<bool>();
-  tx.commit();
   return t;
 }
 
 int TestService::create(const std::string& title, const std::optional<std::string>& description) {
+  Database::Timer db_timer("TestService::create");
   pqxx::work tx{db_.connection()};
+  int result = create(tx, title, description);
+  tx.commit();
+  db_.note_write();
+  return result;
+}
+
+int TestService::create(pqxx::work& tx, const std::string& title, const std::optional<std::string>& description) {
   // Для NULL используем nullptr во втором параметре
   auto r = tx.exec_params(
     "INSERT INTO tests (title, description) VALUES ($1, $2) RETURNING id",
@@ -47,14 +62,23 @@ int TestService::create(const std::string& title, const std::optional<std::strin
     description.has_value() ? *description : nullptr
   );
   int id = r[0]["id"].as<int>();
-  tx.commit();
   return id;
 }
 
 bool TestService::update(int id, const std::optional<std::string>& title,
                          const std::optional<std::string>& description,
                          const std::optional<bool>& is_published) {
+  Database::Timer db_timer("TestService::update");
   pqxx::work tx{db_.connection()};
+  bool result = update(tx, id, title, description, is_published);
+  tx.commit();
+  db_.note_write();
+  return result;
+}
+
+bool TestService::update(pqxx::work& tx, int id, const std::optional<std::string>& title,
+                         const std::optional<std::string>& description,
+                         const std::optional<bool>& is_published) {
   std::string q = "UPDATE tests SET ";
   bool first = true;
   auto addField = [&](const std::string& f) {
@@ -70,13 +94,23 @@ bool TestService::update(int id, const std::optional<std::string>& title,
 
   if (first) return false; // ничего не обновили
   auto res = tx.exec(q);
-  tx.commit();
   return res.affected_rows() > 0;
 }
 
 bool TestService::remove(int id) {
+  Database::Timer db_timer("TestService::remove");
+  SearchIndex::StagedGuard staged_guard{index_};
   pqxx::work tx{db_.connection()};
-  auto res = tx.exec_params("DELETE FROM tests WHERE id = $1", id);
+  bool result = remove(tx, id);
   tx.commit();
-  return res.affected_rows() > 0;
+  db_.note_write();
+  if (index_) index_->commit_staged();
+  return result;
+}
+
+bool TestService::remove(pqxx::work& tx, int id) {
+  auto res = tx.exec_params("DELETE FROM tests WHERE id = $1", id);
+  if (res.affected_rows() == 0) return false;
+  if (index_) index_->stage_remove_test(id);
+  return true;
 }
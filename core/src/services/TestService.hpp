@@ -1,6 +1,7 @@
 #pragma once
 #include "../database/Database.hpp"
 #include "../models/Test.hpp"
+#include "../search/SearchIndex.hpp"
 #include <vector>
 #include <optional>
 #include <string>
@@ -9,6 +10,9 @@ class TestService {
 public:
   explicit TestService(Database& db);
 
+  // Индекс поиска по вопросам: удаление теста каскадно удаляет его вопросы
+  void attach_index(SearchIndex* index) { index_ = index; }
+
   std::vector<Test> list();
   std::optional<Test> get(int id);
   int create(const std::string& title, const std::optional<std::string>& description);
@@ -17,6 +21,15 @@ public:
               const std::optional<bool>& is_published);
   bool remove(int id);
 
+  // Те же операции в транзакции вызывающего (пакетные запросы, чтение с primary): commit делает он
+  std::optional<Test> get(pqxx::work& tx, int id);
+  int create(pqxx::work& tx, const std::string& title, const std::optional<std::string>& description);
+  bool update(pqxx::work& tx, int id, const std::optional<std::string>& title,
+              const std::optional<std::string>& description,
+              const std::optional<bool>& is_published);
+  bool remove(pqxx::work& tx, int id);
+
 private:
   Database& db_;
+  SearchIndex* index_ = nullptr;
 };
@@ -0,0 +1,340 @@
+#include "TestSnapshot.hpp"
+#include "../http/Json.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace snapshot {
+
+namespace {
+
+uint32_t fnv1a(const char* data, size_t len) {
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < len; ++i) {
+    h ^= static_cast<unsigned char>(data[i]);
+    h *= 16777619u;
+  }
+  return h;
+}
+
+template <typename T>
+void append_pod(std::string& out, const T& v) {
+  out.append(reinterpret_cast<const char*>(&v), sizeof(T));
+}
+
+// Пул строк с дедупликацией одинаковых значений
+class StringPool {
+public:
+  StrRef add(const std::string& s) {
+    auto it = seen_.find(s);
+    if (it != seen_.end()) return it->second;
+    StrRef ref{static_cast<uint32_t>(data_.size()), static_cast<uint32_t>(s.size())};
+    data_ += s;
+    seen_.emplace(s, ref);
+    return ref;
+  }
+  const std::string& data() const { return data_; }
+
+private:
+  std::string data_;
+  std::map<std::string, StrRef> seen_;
+};
+
+} // namespace
+
+std::string compile(const Test& test,
+                    const std::vector<Question>& questions,
+                    const std::vector<std::vector<Answer>>& answers) {
+  if (answers.size() != questions.size()) {
+    throw std::invalid_argument("snapshot: answers must be given for every question");
+  }
+
+  // Порядок прохождения: order_index, затем id
+  std::vector<size_t> order(questions.size());
+  for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+  std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    if (questions[a].order_index != questions[b].order_index)
+      return questions[a].order_index < questions[b].order_index;
+    return questions[a].id < questions[b].id;
+  });
+
+  StringPool pool;
+  std::vector<StrRef> types;
+  std::map<std::string, uint16_t> type_idx;
+  std::vector<QuestionRecord> qrecs;
+  std::vector<AnswerRecord> arecs;
+  qrecs.reserve(questions.size());
+
+  SnapshotHeader h{};
+  std::memcpy(h.magic, kMagic, sizeof(kMagic));
+  h.version = kVersion;
+  h.test_id = test.id;
+  h.title = pool.add(test.title);
+  if (test.description.has_value()) {
+    h.flags |= kFlagHasDescription;
+    h.description = pool.add(*test.description);
+  }
+
+  for (size_t i : order) {
+    const Question& q = questions[i];
+    auto t = type_idx.find(q.type);
+    if (t == type_idx.end()) {
+      t = type_idx.emplace(q.type, static_cast<uint16_t>(types.size())).first;
+      types.push_back(pool.add(q.type));
+    }
+
+    QuestionRecord qr{};
+    qr.id = q.id;
+    qr.order_index = q.order_index;
+    qr.points = 1;  // баллов в модели пока нет — по умолчанию 1, как в 01_init.sql
+    qr.type_idx = t->second;
+    qr.text = pool.add(q.text);
+    qr.answers_begin = static_cast<uint32_t>(arecs.size());
+    for (const Answer& a : answers[i]) {
+      AnswerRecord ar{};
+      ar.id = a.id;
+      ar.is_correct = a.is_correct ? 1 : 0;
+      ar.text = pool.add(a.text);
+      if (a.is_correct) ++qr.correct_count;
+      arecs.push_back(ar);
+    }
+    qr.answers_count = static_cast<uint32_t>(arecs.size()) - qr.answers_begin;
+    qrecs.push_back(qr);
+  }
+
+  std::vector<uint32_t> by_id(qrecs.size());
+  for (uint32_t i = 0; i < by_id.size(); ++i) by_id[i] = i;
+  std::sort(by_id.begin(), by_id.end(), [&](uint32_t a, uint32_t b) { return qrecs[a].id < qrecs[b].id; });
+
+  uint32_t off = sizeof(SnapshotHeader);
+  h.type_count = static_cast<uint32_t>(types.size());
+  h.types_off = off;
+  off += h.type_count * sizeof(StrRef);
+  h.question_count = static_cast<uint32_t>(qrecs.size());
+  h.questions_off = off;
+  off += h.question_count * sizeof(QuestionRecord);
+  h.by_id_off = off;
+  off += h.question_count * sizeof(uint32_t);
+  h.answer_count = static_cast<uint32_t>(arecs.size());
+  h.answers_off = off;
+  off += h.answer_count * sizeof(AnswerRecord);
+  h.strings_off = off;
+  h.strings_size = static_cast<uint32_t>(pool.data().size());
+  h.total_size = off + h.strings_size;
+
+  std::string blob;
+  blob.reserve(h.total_size);
+  append_pod(blob, h);
+  for (const auto& t : types) append_pod(blob, t);
+  for (const auto& q : qrecs) append_pod(blob, q);
+  for (uint32_t i : by_id) append_pod(blob, i);
+  for (const auto& a : arecs) append_pod(blob, a);
+  blob += pool.data();
+
+  uint32_t sum = fnv1a(blob.data() + sizeof(SnapshotHeader), blob.size() - sizeof(SnapshotHeader));
+  std::memcpy(&blob[offsetof(SnapshotHeader, checksum)], &sum, sizeof(sum));
+  return blob;
+}
+
+void write_file(const std::string& path, const std::string& blob) {
+  std::string tmp = path + ".tmp";
+  int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) throw std::runtime_error("snapshot: cannot create " + tmp);
+  size_t written = 0;
+  while (written < blob.size()) {
+    ssize_t n = ::write(fd, blob.data() + written, blob.size() - written);
+    if (n <= 0) {
+      ::close(fd);
+      ::unlink(tmp.c_str());
+      throw std::runtime_error("snapshot: write failed for " + tmp);
+    }
+    written += static_cast<size_t>(n);
+  }
+  ::fsync(fd);
+  ::close(fd);
+  if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+    ::unlink(tmp.c_str());
+    throw std::runtime_error("snapshot: cannot rename " + tmp);
+  }
+}
+
+MappedSnapshot::MappedSnapshot(const std::string& path) {
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) throw std::runtime_error("snapshot: cannot open " + path);
+  struct stat st{};
+  if (::fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(SnapshotHeader))) {
+    ::close(fd);
+    throw std::runtime_error("snapshot: file too small " + path);
+  }
+  void* p = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (p == MAP_FAILED) throw std::runtime_error("snapshot: mmap failed for " + path);
+  base_ = static_cast<const char*>(p);
+  size_ = static_cast<size_t>(st.st_size);
+  try {
+    validate();
+  } catch (...) {
+    unmap();
+    throw;
+  }
+}
+
+MappedSnapshot::~MappedSnapshot() { unmap(); }
+
+MappedSnapshot::MappedSnapshot(MappedSnapshot&& other) noexcept
+  : base_(other.base_), size_(other.size_) {
+  other.base_ = nullptr;
+  other.size_ = 0;
+}
+
+MappedSnapshot& MappedSnapshot::operator=(MappedSnapshot&& other) noexcept {
+  if (this != &other) {
+    unmap();
+    base_ = other.base_;
+    size_ = other.size_;
+    other.base_ = nullptr;
+    other.size_ = 0;
+  }
+  return *this;
+}
+
+void MappedSnapshot::unmap() {
+  if (base_) ::munmap(const_cast<char*>(base_), size_);
+  base_ = nullptr;
+  size_ = 0;
+}
+
+void MappedSnapshot::validate() const {
+  const SnapshotHeader& h = header();
+  if (std::memcmp(h.magic, kMagic, sizeof(kMagic)) != 0) throw std::runtime_error("snapshot: bad magic");
+  if (h.version != kVersion) throw std::runtime_error("snapshot: unsupported version " + std::to_string(h.version));
+  if (h.total_size != size_) throw std::runtime_error("snapshot: size mismatch");
+
+  auto in_bounds = [&](uint64_t off, uint64_t count, uint64_t elem) {
+    return off % 4 == 0 && off + count * elem <= size_;
+  };
+  if (!in_bounds(h.types_off, h.type_count, sizeof(StrRef)) ||
+      !in_bounds(h.questions_off, h.question_count, sizeof(QuestionRecord)) ||
+      !in_bounds(h.by_id_off, h.question_count, sizeof(uint32_t)) ||
+      !in_bounds(h.answers_off, h.answer_count, sizeof(AnswerRecord)) ||
+      static_cast<uint64_t>(h.strings_off) + h.strings_size > size_) {
+    throw std::runtime_error("snapshot: section out of bounds");
+  }
+  if (fnv1a(base_ + sizeof(SnapshotHeader), size_ - sizeof(SnapshotHeader)) != h.checksum) {
+    throw std::runtime_error("snapshot: checksum mismatch");
+  }
+
+  // После проверки контрольной суммы ссылки внутри блоба считаем доверенными,
+  // но индексы всё равно проверяем, чтобы битый компилятор не дал выход за границы.
+  auto str_ok = [&](const StrRef& r) {
+    return static_cast<uint64_t>(r.off) + r.len <= h.strings_size;
+  };
+  if (!str_ok(h.title) || !str_ok(h.description)) throw std::runtime_error("snapshot: corrupt header strings");
+  const StrRef* types = reinterpret_cast<const StrRef*>(base_ + h.types_off);
+  for (uint32_t i = 0; i < h.type_count; ++i) {
+    if (!str_ok(types[i])) throw std::runtime_error("snapshot: corrupt type table");
+  }
+  for (uint32_t i = 0; i < h.question_count; ++i) {
+    const QuestionRecord& q = questions()[i];
+    if (q.type_idx >= h.type_count || !str_ok(q.text) ||
+        static_cast<uint64_t>(q.answers_begin) + q.answers_count > h.answer_count ||
+        by_id()[i] >= h.question_count) {
+      throw std::runtime_error("snapshot: corrupt question record");
+    }
+  }
+  for (uint32_t i = 0; i < h.answer_count; ++i) {
+    if (!str_ok(answers()[i].text)) throw std::runtime_error("snapshot: corrupt answer record");
+  }
+}
+
+const QuestionRecord* MappedSnapshot::find_question(int question_id) const {
+  const uint32_t* first = by_id();
+  const uint32_t* last = first + question_count();
+  const uint32_t* it = std::lower_bound(first, last, question_id, [&](uint32_t idx, int id) {
+    return questions()[idx].id < id;
+  });
+  if (it == last || questions()[*it].id != question_id) return nullptr;
+  return &questions()[*it];
+}
+
+std::string_view MappedSnapshot::type_of(const QuestionRecord& q) const {
+  const StrRef* types = reinterpret_cast<const StrRef*>(base_ + header().types_off);
+  return str(types[q.type_idx]);
+}
+
+uint32_t MappedSnapshot::max_score() const {
+  uint32_t total = 0;
+  for (uint32_t i = 0; i < question_count(); ++i) total += question(i).points;
+  return total;
+}
+
+uint32_t MappedSnapshot::grade(int question_id, const std::vector<int>& selected_answer_ids) const {
+  const QuestionRecord* q = find_question(question_id);
+  if (!q || q->correct_count == 0) return 0;  // текстовые вопросы проверяются вручную
+
+  const AnswerRecord* a = answers_of(*q);
+  // Повторно выбранный ответ засчитывается один раз: иначе [100,100] закрывал бы два правильных
+  std::vector<bool> matched(q->answers_count, false);
+  uint32_t hits = 0;
+  for (int sel : selected_answer_ids) {
+    uint32_t i = 0;
+    while (i < q->answers_count && a[i].id != sel) ++i;
+    if (i == q->answers_count || !a[i].is_correct) return 0;
+    if (matched[i]) continue;
+    matched[i] = true;
+    ++hits;
+  }
+  return hits == q->correct_count ? q->points : 0;
+}
+
+std::string MappedSnapshot::to_json() const {
+  const SnapshotHeader& h = header();
+  std::string json;
+  json.reserve(size_ * 2);
+  // Строки из БД экранируются: JSON кэшируется вместе со сжатыми вариантами
+  auto add_str = [&json](std::string_view s) { json += http::json_escape(std::string(s)); };
+  json += "{\"id\":" + std::to_string(h.test_id);
+  json += ",\"title\":\"";
+  add_str(title());
+  json += "\"";
+  if (h.flags & kFlagHasDescription) {
+    json += ",\"description\":\"";
+    add_str(str(h.description));
+    json += "\"";
+  }
+  json += ",\"max_score\":" + std::to_string(max_score());
+  json += ",\"questions\":[";
+  for (uint32_t i = 0; i < question_count(); ++i) {
+    const QuestionRecord& q = question(i);
+    if (i) json += ",";
+    json += "{\"id\":" + std::to_string(q.id);
+    json += ",\"test_id\":" + std::to_string(h.test_id);
+    json += ",\"text\":\"";
+    add_str(str(q.text));
+    json += "\",\"type\":\"";
+    add_str(type_of(q));
+    json += "\",\"order_index\":" + std::to_string(q.order_index);
+    json += ",\"points\":" + std::to_string(q.points);
+    json += ",\"answers\":[";
+    const AnswerRecord* a = answers_of(q);
+    for (uint32_t j = 0; j < q.answers_count; ++j) {
+      if (j) json += ",";
+      json += "{\"id\":" + std::to_string(a[j].id);
+      json += ",\"question_id\":" + std::to_string(q.id);
+      json += ",\"text\":\"";
+      add_str(str(a[j].text));
+      json += "\"}";
+    }
+    json += "]}";
+  }
+  json += "]}";
+  return json;
+}
+
+} // namespace snapshot
@@ -0,0 +1,128 @@
+#pragma once
+#include "../models/Test.hpp"
+#include "../models/Question.hpp"
+#include "../models/Answer.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Бинарный снимок опубликованного теста.
+//
+// Снимок неизменяем: вопросы, варианты ответа, порядок и баллы собраны в один
+// блоб со смещениями относительно его начала, поэтому файл можно отобразить
+// в память (mmap) и отдавать/проверять тест без обращения к БД.
+//
+// Раскладка (little-endian, всё выровнено на 4 байта):
+//   SnapshotHeader
+//   StrRef[type_count]            — интернированные строки типов вопросов
+//   QuestionRecord[question_count] — в порядке прохождения (order_index, id)
+//   uint32_t[question_count]      — индексы вопросов, отсортированные по id
+//   AnswerRecord[answer_count]    — ответы подряд, сгруппированы по вопросу
+//   char[strings_size]            — пул строк (без завершающих нулей)
+
+namespace snapshot {
+
+constexpr char kMagic[4] = {'T', 'S', 'N', 'P'};
+constexpr uint16_t kVersion = 1;
+constexpr uint16_t kFlagHasDescription = 1u << 0;
+
+struct StrRef {
+  uint32_t off;
+  uint32_t len;
+};
+
+struct SnapshotHeader {
+  char magic[4];
+  uint16_t version;
+  uint16_t flags;
+  uint32_t total_size;
+  int32_t test_id;
+  StrRef title;
+  StrRef description;
+  uint32_t type_count;
+  uint32_t types_off;
+  uint32_t question_count;
+  uint32_t questions_off;
+  uint32_t by_id_off;
+  uint32_t answer_count;
+  uint32_t answers_off;
+  uint32_t strings_off;
+  uint32_t strings_size;
+  uint32_t checksum;  // FNV-1a всего, что идёт после заголовка
+};
+
+struct QuestionRecord {
+  int32_t id;
+  int32_t order_index;
+  uint32_t points;
+  uint16_t type_idx;
+  uint16_t correct_count;
+  StrRef text;
+  uint32_t answers_begin;
+  uint32_t answers_count;
+};
+
+struct AnswerRecord {
+  int32_t id;
+  uint32_t is_correct;
+  StrRef text;
+};
+
+static_assert(sizeof(SnapshotHeader) % 4 == 0, "header must keep 4-byte alignment");
+static_assert(sizeof(QuestionRecord) == 32, "QuestionRecord layout is part of the format");
+static_assert(sizeof(AnswerRecord) == 16, "AnswerRecord layout is part of the format");
+
+// Собирает блоб снимка. answers[i] — варианты ответа для questions[i].
+std::string compile(const Test& test,
+                    const std::vector<Question>& questions,
+                    const std::vector<std::vector<Answer>>& answers);
+
+// Атомарно записывает блоб в файл (tmp + rename).
+void write_file(const std::string& path, const std::string& blob);
+
+// Снимок, отображённый в память только для чтения.
+class MappedSnapshot {
+public:
+  // Бросает std::runtime_error, если файл не читается или повреждён.
+  explicit MappedSnapshot(const std::string& path);
+  ~MappedSnapshot();
+
+  MappedSnapshot(const MappedSnapshot&) = delete;
+  MappedSnapshot& operator=(const MappedSnapshot&) = delete;
+  MappedSnapshot(MappedSnapshot&& other) noexcept;
+  MappedSnapshot& operator=(MappedSnapshot&& other) noexcept;
+
+  int test_id() const { return header().test_id; }
+  size_t size() const { return size_; }
+  std::string_view title() const { return str(header().title); }
+
+  uint32_t question_count() const { return header().question_count; }
+  const QuestionRecord& question(uint32_t i) const { return questions()[i]; }
+  const QuestionRecord* find_question(int question_id) const;
+  const AnswerRecord* answers_of(const QuestionRecord& q) const { return answers() + q.answers_begin; }
+  std::string_view type_of(const QuestionRecord& q) const;
+  std::string_view str(const StrRef& ref) const { return {base_ + header().strings_off + ref.off, ref.len}; }
+
+  uint32_t max_score() const;
+  // Баллы за вопрос: выбранный набор должен совпасть с набором правильных ответов.
+  uint32_t grade(int question_id, const std::vector<int>& selected_answer_ids) const;
+
+  // Полное дерево теста для прохождения: поля как в testToJson/questionToJson/answerToJson,
+  // но без is_correct, чтобы не раскрывать правильные ответы.
+  std::string to_json() const;
+
+private:
+  const SnapshotHeader& header() const { return *reinterpret_cast<const SnapshotHeader*>(base_); }
+  const QuestionRecord* questions() const { return reinterpret_cast<const QuestionRecord*>(base_ + header().questions_off); }
+  const AnswerRecord* answers() const { return reinterpret_cast<const AnswerRecord*>(base_ + header().answers_off); }
+  const uint32_t* by_id() const { return reinterpret_cast<const uint32_t*>(base_ + header().by_id_off); }
+  void validate() const;
+  void unmap();
+
+  const char* base_ = nullptr;
+  size_t size_ = 0;
+};
+
+} // namespace snapshot
@@ -0,0 +1,69 @@
+#include "TimerWheel.hpp"
+
+void TimerWheel::place(const Entry& e) {
+  Slot* slot = &due_;
+  if (e.deadline > now_) {
+    slot = nullptr;
+    for (int level = 0; level < kLevels && !slot; ++level) {
+      const int shift = level * kBits;
+      // Уровень, на котором срок меньше чем в 64 слотах от текущего положения:
+      // такой слот будет пройден не раньше срока
+      if ((e.deadline >> shift) - (now_ >> shift) < kSlots) {
+        slot = &wheel_[level][(e.deadline >> shift) & (kSlots - 1)];
+      }
+    }
+    if (!slot) {
+      // Дальше горизонта: в старший уровень, при обходе слота переложится заново
+      const int shift = (kLevels - 1) * kBits;
+      slot = &wheel_[kLevels - 1][((now_ >> shift) - 1) & (kSlots - 1)];
+    }
+  }
+  slot->push_back(e);
+  where_[e.id] = Location{slot, std::prev(slot->end())};
+}
+
+void TimerWheel::schedule(int id, int64_t deadline_s) {
+  cancel(id);
+  place(Entry{id, deadline_s});
+}
+
+bool TimerWheel::cancel(int id) {
+  auto it = where_.find(id);
+  if (it == where_.end()) return false;
+  it->second.slot->erase(it->second.it);
+  where_.erase(it);
+  return true;
+}
+
+void TimerWheel::cascade(int level) {
+  Slot& slot = wheel_[level][(now_ >> (level * kBits)) & (kSlots - 1)];
+  Slot moving;
+  moving.swap(slot);
+  for (const Entry& e : moving) {
+    where_.erase(e.id);
+    place(e);
+  }
+}
+
+std::vector<int> TimerWheel::advance(int64_t now_s) {
+  std::vector<int> fired;
+  auto collect = [&](Slot& slot) {
+    for (const Entry& e : slot) {
+      fired.push_back(e.id);
+      where_.erase(e.id);
+    }
+    slot.clear();
+  };
+
+  collect(due_);
+  while (now_ < now_s) {
+    ++now_;
+    // Сначала перекладываем старшие уровни, чьи границы пройдены на этом шаге
+    for (int level = kLevels - 1; level >= 1; --level) {
+      if ((now_ & ((int64_t{1} << (level * kBits)) - 1)) == 0) cascade(level);
+    }
+    collect(wheel_[0][now_ & (kSlots - 1)]);
+    collect(due_);
+  }
+  return fired;
+}
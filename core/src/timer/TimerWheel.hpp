@@ -0,0 +1,50 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+// Иерархическое колесо таймеров с шагом в одну секунду.
+//
+// 4 уровня по 64 слота: ~64 с, ~68 мин, ~3 дня, ~194 дня. Добавление и отмена
+// за O(1); при проходе через границу уровня слот старшего уровня
+// перераскладывается в младшие. Сроки дальше горизонта кладутся в старший
+// уровень и перекладываются, пока не станут достижимы.
+class TimerWheel {
+public:
+  explicit TimerWheel(int64_t now_s) : now_(now_s) {}
+
+  // Срок в секундах (то же время, что передаётся в advance). Повторный вызов переносит таймер.
+  void schedule(int id, int64_t deadline_s);
+  // false, если такого таймера нет
+  bool cancel(int id);
+  // Продвигает время до now_s и возвращает id сработавших таймеров
+  std::vector<int> advance(int64_t now_s);
+
+  size_t size() const { return where_.size(); }
+  int64_t now() const { return now_; }
+
+private:
+  static constexpr int kLevels = 4;
+  static constexpr int kBits = 6;
+  static constexpr int kSlots = 1 << kBits;
+
+  struct Entry {
+    int id;
+    int64_t deadline;
+  };
+  using Slot = std::list<Entry>;
+  struct Location {
+    Slot* slot;
+    Slot::iterator it;
+  };
+
+  void place(const Entry& e);
+  void cascade(int level);
+
+  int64_t now_;
+  Slot wheel_[kLevels][kSlots];
+  Slot due_;  // срок уже наступил, отдаются на ближайшем advance
+  std::unordered_map<int, Location> where_;
+};
@@ -0,0 +1,163 @@
+#include "Trace.hpp"
+#include <chrono>
+#include <map>
+#include <thread>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define CORE_TRACE_RDTSC 1
+#endif
+
+namespace trace {
+
+namespace {
+
+double g_ticks_per_us = 1000.0;  // для steady_clock (нс) до калибровки
+bool g_server_timing = false;
+thread_local RequestTrace* t_current = nullptr;
+
+uint64_t steady_ns() {
+  return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void append_escaped(std::string& out, const std::string& s) {
+  for (char c : s) {
+    if (c == '"' || c == '\\') out += '\\';
+    if (static_cast<unsigned char>(c) >= 0x20) out += c;
+  }
+}
+
+} // namespace
+
+uint64_t now_ticks() {
+#ifdef CORE_TRACE_RDTSC
+  return __rdtsc();
+#else
+  return steady_ns();
+#endif
+}
+
+void calibrate() {
+#ifdef CORE_TRACE_RDTSC
+  uint64_t ns0 = steady_ns();
+  uint64_t t0 = __rdtsc();
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  uint64_t t1 = __rdtsc();
+  uint64_t ns1 = steady_ns();
+  if (ns1 > ns0 && t1 > t0) g_ticks_per_us = static_cast<double>(t1 - t0) * 1000.0 / static_cast<double>(ns1 - ns0);
+#endif
+}
+
+double ticks_to_us(uint64_t ticks) { return static_cast<double>(ticks) / g_ticks_per_us; }
+
+void set_server_timing(bool enabled) { g_server_timing = enabled; }
+bool server_timing_enabled() { return g_server_timing; }
+
+void RequestTrace::begin(uint64_t request_id) {
+  count_ = 0;
+  depth_ = 0;
+  id_ = request_id;
+  start_ = now_ticks();
+  end_ = 0;
+  t_current = this;
+}
+
+void RequestTrace::end() {
+  end_ = now_ticks();
+  if (t_current == this) t_current = nullptr;
+}
+
+RequestTrace* RequestTrace::current() { return t_current; }
+
+size_t RequestTrace::open(const char* name, const char* cat) {
+  if (count_ >= kMaxSpans) return kMaxSpans;  // переполнение: спан молча теряется
+  spans_[count_] = SpanRecord{name, cat, now_ticks(), 0, depth_};
+  ++depth_;
+  return count_++;
+}
+
+void RequestTrace::close(size_t idx) {
+  if (idx >= kMaxSpans) return;
+  spans_[idx].end = now_ticks();
+  if (depth_ > 0) --depth_;
+}
+
+double RequestTrace::total_us() const {
+  uint64_t last = end_ ? end_ : now_ticks();
+  return ticks_to_us(last - start_);
+}
+
+std::string RequestTrace::server_timing() const {
+  // Порядок категорий — порядок первого появления
+  std::map<std::string, double> dur;
+  std::string order[kMaxSpans];
+  size_t n = 0;
+  for (size_t i = 0; i < count_; ++i) {
+    const SpanRecord& s = spans_[i];
+    if (!s.end) continue;
+    auto it = dur.find(s.cat);
+    if (it == dur.end()) {
+      order[n++] = s.cat;
+      it = dur.emplace(s.cat, 0.0).first;
+    }
+    it->second += ticks_to_us(s.end - s.start);
+  }
+  std::string out;
+  char buf[32];
+  for (size_t i = 0; i < n; ++i) {
+    if (i) out += ", ";
+    std::snprintf(buf, sizeof(buf), ";dur=%.3f", dur[order[i]] / 1000.0);  // миллисекунды
+    out += order[i];
+    out += buf;
+  }
+  return out;
+}
+
+void RequestTrace::append_chrome_events(std::string& out, const std::string& label) const {
+  char buf[160];
+  // Общий спан запроса — строка в просмотрщике подписана методом и путём
+  std::snprintf(buf, sizeof(buf), "{\"name\":\"");
+  out += buf;
+  append_escaped(out, label);
+  std::snprintf(buf, sizeof(buf), "\",\"cat\":\"request\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%llu},\n",
+                ticks_to_us(start_), total_us(), static_cast<unsigned long long>(id_));
+  out += buf;
+  for (size_t i = 0; i < count_; ++i) {
+    const SpanRecord& s = spans_[i];
+    if (!s.end) continue;
+    std::snprintf(buf, sizeof(buf),
+                  "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%llu},\n",
+                  s.name, s.cat, ticks_to_us(s.start), ticks_to_us(s.end - s.start),
+                  static_cast<unsigned long long>(id_));
+    out += buf;
+  }
+}
+
+TraceSink::TraceSink(const std::string& path, uint64_t every_n, double slow_us)
+  : every_n_(every_n), slow_us_(slow_us) {
+  file_ = std::fopen(path.c_str(), "w");
+  // Формат JSON Array: закрывающая скобка необязательна, поэтому файл можно
+  // открыть в просмотрщике, не останавливая сервер
+  if (file_) std::fputs("[\n", file_);
+  else std::fprintf(stderr, "trace: cannot open %s\n", path.c_str());
+}
+
+TraceSink::~TraceSink() {
+  if (file_) std::fclose(file_);
+}
+
+bool TraceSink::should_dump(const RequestTrace& t) const {
+  if (!file_) return false;
+  if (every_n_ > 0 && t.id() % every_n_ == 0) return true;
+  return slow_us_ > 0 && t.total_us() >= slow_us_;
+}
+
+void TraceSink::dump(const RequestTrace& t, const std::string& label) {
+  std::string out;
+  out.reserve(1024);
+  t.append_chrome_events(out, label);
+  std::fwrite(out.data(), 1, out.size(), file_);
+  std::fflush(file_);
+}
+
+} // namespace trace
@@ -0,0 +1,91 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+// Трассировка фаз обработки запроса.
+//
+// Span — RAII-замер участка кода по счётчику тактов (rdtsc на x86-64,
+// steady_clock на остальных). Спаны пишутся в RequestTrace текущего потока;
+// если трассировка запроса не включена, Span ничего не делает.
+// Из трассы строится заголовок Server-Timing, а выборочные трассы
+// сохраняются в файл в формате Chrome trace-event (chrome://tracing, Perfetto).
+
+namespace trace {
+
+// Один раз при старте: замер частоты счётчика тактов.
+void calibrate();
+uint64_t now_ticks();
+double ticks_to_us(uint64_t ticks);
+
+void set_server_timing(bool enabled);
+bool server_timing_enabled();
+
+struct SpanRecord {
+  const char* name;
+  const char* cat;   // категория для Server-Timing: read, parse, route, db, json, ...
+  uint64_t start;
+  uint64_t end;
+  uint16_t depth;
+};
+
+class RequestTrace {
+public:
+  static constexpr size_t kMaxSpans = 64;
+
+  // Начинает трассу запроса и делает её текущей для потока.
+  void begin(uint64_t request_id);
+  // Снимает трассу с потока; спаны остаются доступны для выгрузки.
+  void end();
+  static RequestTrace* current();
+
+  size_t open(const char* name, const char* cat);
+  void close(size_t idx);
+
+  uint64_t id() const { return id_; }
+  double total_us() const;
+  // "route;dur=1.234, db;dur=0.8, ..." — суммы по категориям
+  std::string server_timing() const;
+  void append_chrome_events(std::string& out, const std::string& label) const;
+
+private:
+  SpanRecord spans_[kMaxSpans];
+  size_t count_ = 0;
+  uint16_t depth_ = 0;
+  uint64_t id_ = 0;
+  uint64_t start_ = 0;
+  uint64_t end_ = 0;
+};
+
+class Span {
+public:
+  explicit Span(const char* name, const char* cat = nullptr)
+    : trace_(RequestTrace::current()), idx_(trace_ ? trace_->open(name, cat ? cat : name) : 0) {}
+  ~Span() { if (trace_) trace_->close(idx_); }
+  Span(const Span&) = delete;
+  Span& operator=(const Span&) = delete;
+
+private:
+  RequestTrace* trace_;
+  size_t idx_;
+};
+
+// Выгрузка выборочных трасс: каждая every_n-я и все медленнее slow_us.
+class TraceSink {
+public:
+  TraceSink(const std::string& path, uint64_t every_n, double slow_us);
+  ~TraceSink();
+  TraceSink(const TraceSink&) = delete;
+  TraceSink& operator=(const TraceSink&) = delete;
+
+  bool should_dump(const RequestTrace& t) const;
+  void dump(const RequestTrace& t, const std::string& label);
+
+private:
+  std::FILE* file_ = nullptr;
+  uint64_t every_n_;
+  double slow_us_;
+};
+
+} // namespace trace
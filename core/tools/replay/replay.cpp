@@ -0,0 +1,358 @@
+// core-replay: воспроизведение записанного трафика (CAPTURE_FILE) против core-api.
+//
+//   core-replay [--target tcp:HOST:PORT|unix:PATH] [--speed 1|N|max]
+//               [--connections N] [--auth TEMPLATE --users N] capture.bin
+//
+// Каждый поток держит своё keep-alive соединение и переподключается, если сервер
+// его закрыл. В режиме 1×/N× запросы уходят по записанному расписанию, а задержка
+// считается от запланированного момента, чтобы очередь на стороне клиента не
+// скрывала замедление сервера. В конце — пропускная способность и перцентили
+// задержки по маршрутам (шаблоны как в журнале доступа).
+
+#include "http/Capture.hpp"
+#include "http/Route.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+  std::string target = "tcp:127.0.0.1:8082";
+  double speed = 1.0;  // 0 — максимальная скорость
+  unsigned connections = 64;
+  std::string auth;    // шаблон Authorization, "{n}" — номер пользователя 1..users
+  unsigned users = 1000;
+  std::string file;
+};
+
+struct RouteStats {
+  std::vector<uint32_t> latency_us;
+  uint64_t errors = 0;  // нет ответа или статус 5xx
+  std::map<int, uint64_t> statuses;
+};
+
+using Stats = std::map<std::string, RouteStats>;
+
+int connect_target(const Options& opt) {
+  if (opt.target.rfind("unix:", 0) == 0) {
+    std::string path = opt.target.substr(5);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+      if (fd >= 0) close(fd);
+      return -1;
+    }
+    return fd;
+  }
+
+  std::string hostport = opt.target.rfind("tcp:", 0) == 0 ? opt.target.substr(4) : opt.target;
+  size_t colon = hostport.rfind(':');
+  std::string host = colon == std::string::npos ? hostport : hostport.substr(0, colon);
+  std::string port = colon == std::string::npos ? "8082" : hostport.substr(colon + 1);
+  addrinfo hints{};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  addrinfo* res = nullptr;
+  if (getaddrinfo(host.c_str(), port.c_str(), &hints, &res) != 0) return -1;
+  int fd = -1;
+  for (addrinfo* ai = res; ai; ai = ai->ai_next) {
+    fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+    if (fd < 0) continue;
+    if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) break;
+    close(fd);
+    fd = -1;
+  }
+  freeaddrinfo(res);
+  if (fd >= 0) {
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  }
+  return fd;
+}
+
+bool send_all(int fd, const std::string& data) {
+  size_t sent = 0;
+  while (sent < data.size()) {
+    ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    sent += static_cast<size_t>(n);
+  }
+  return true;
+}
+
+// Соединение ещё живо: сервер core-api закрывает его после каждого ответа
+bool still_open(int fd) {
+  char c;
+  ssize_t n = recv(fd, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+  return n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+}
+
+struct Response {
+  int status = 0;
+  bool keep_alive = true;
+};
+
+// Читает один ответ: Content-Length, chunked или до закрытия соединения.
+// status == 0 — ответа нет.
+Response read_response(int fd, std::string& buf) {
+  Response resp;
+  buf.clear();
+  char chunk[16384];
+  auto fill = [&]() {
+    ssize_t n;
+    do n = recv(fd, chunk, sizeof(chunk), 0); while (n < 0 && errno == EINTR);
+    if (n > 0) buf.append(chunk, static_cast<size_t>(n));
+    return n > 0;
+  };
+
+  size_t header_end;
+  while ((header_end = buf.find("\r\n\r\n")) == std::string::npos) {
+    if (!fill()) return resp;
+  }
+  if (buf.compare(0, 5, "HTTP/") != 0) return resp;
+  int status = std::atoi(buf.c_str() + buf.find(' ') + 1);
+
+  std::string headers = buf.substr(0, header_end);
+  for (char& c : headers) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+  size_t body_start = header_end + 4;
+  if (headers.find("\r\nconnection: close") != std::string::npos) resp.keep_alive = false;
+
+  size_t cl = headers.find("\r\ncontent-length:");
+  if (cl != std::string::npos) {
+    size_t need = body_start + std::strtoul(headers.c_str() + cl + 17, nullptr, 10);
+    while (buf.size() < need) {
+      if (!fill()) return resp;
+    }
+  } else if (headers.find("\r\ntransfer-encoding: chunked") != std::string::npos) {
+    size_t pos = body_start;
+    for (;;) {
+      size_t eol;
+      while ((eol = buf.find("\r\n", pos)) == std::string::npos) {
+        if (!fill()) return resp;
+      }
+      size_t size = std::strtoul(buf.c_str() + pos, nullptr, 16);
+      size_t next = eol + 2 + size + 2;
+      while (buf.size() < next) {
+        if (!fill()) return resp;
+      }
+      // Тело не нужно — выбрасываем прочитанное, чтобы память не росла на больших выгрузках
+      buf.erase(0, next);
+      pos = 0;
+      if (size == 0) break;
+    }
+  } else {
+    while (fill()) {}
+    resp.keep_alive = false;
+  }
+  resp.status = status;
+  return resp;
+}
+
+// Метод и путь из первой строки запроса
+std::string route_of(const std::string& request) {
+  size_t sp1 = request.find(' ');
+  size_t sp2 = sp1 == std::string::npos ? sp1 : request.find(' ', sp1 + 1);
+  if (sp2 == std::string::npos) return "?";
+  return request.substr(0, sp1) + " " + http::route_pattern(request.substr(sp1 + 1, sp2 - sp1 - 1));
+}
+
+// Подстановка Authorization по шаблону вместо "scrubbed-<номер псевдонима>":
+// разные пользователи записи расходятся по --users номерам по кругу
+std::string apply_auth(const std::string& request, const Options& opt) {
+  if (opt.auth.empty()) return request;
+  size_t pos = request.find(": scrubbed-");
+  if (pos == std::string::npos) return request;
+  size_t line = request.rfind("\r\n", pos);
+  line = line == std::string::npos ? 0 : line + 2;
+  std::string name = request.substr(line, pos - line);
+  for (char& c : name) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+  if (name != "authorization") return request;
+
+  size_t end = request.find("\r\n", pos);
+  uint32_t pseudonym = std::strtoul(request.c_str() + pos + 11, nullptr, 16);
+  std::string value = opt.auth;
+  size_t n = value.find("{n}");
+  if (n != std::string::npos) value.replace(n, 3, std::to_string(pseudonym % opt.users + 1));
+  return request.substr(0, pos + 2) + value + request.substr(end);
+}
+
+double percentile(const std::vector<uint32_t>& sorted, double p) {
+  if (sorted.empty()) return 0;
+  size_t idx = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+  return sorted[idx] / 1000.0;
+}
+
+void usage() {
+  std::cerr << "usage: core-replay [--target tcp:HOST:PORT|unix:PATH] [--speed 1|N|max]\n"
+               "                   [--connections N] [--auth 'Bearer {n}' --users N] capture.bin\n";
+}
+
+bool parse_options(int argc, char** argv, Options& opt) {
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    auto value = [&]() -> std::string { return i + 1 < argc ? argv[++i] : ""; };
+    if (arg == "--target") opt.target = value();
+    else if (arg == "--speed") {
+      std::string v = value();
+      opt.speed = v == "max" ? 0.0 : std::atof(v.c_str());
+      if (v != "max" && opt.speed <= 0) return false;
+    }
+    else if (arg == "--connections") opt.connections = std::max(1, std::atoi(value().c_str()));
+    else if (arg == "--auth") opt.auth = value();
+    else if (arg == "--users") opt.users = std::max(1, std::atoi(value().c_str()));
+    else if (!arg.empty() && arg[0] != '-' && opt.file.empty()) opt.file = arg;
+    else return false;
+  }
+  return !opt.file.empty();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  Options opt;
+  if (!parse_options(argc, argv, opt)) {
+    usage();
+    return 2;
+  }
+
+  std::vector<http::CapturedRequest> requests;
+  try {
+    requests = http::read_capture(opt.file);
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  if (requests.empty()) {
+    std::cerr << "capture is empty" << std::endl;
+    return 1;
+  }
+  std::vector<std::string> routes;
+  routes.reserve(requests.size());
+  for (auto& r : requests) {
+    r.bytes = apply_auth(r.bytes, opt);
+    routes.push_back(route_of(r.bytes));
+  }
+
+  std::cout << "Replaying " << requests.size() << " requests against " << opt.target << " at ";
+  if (opt.speed > 0) std::cout << opt.speed << "x";
+  else std::cout << "max rate";
+  std::cout << " with " << opt.connections << " connections" << std::endl;
+
+  std::atomic<size_t> next{0};
+  std::vector<Stats> per_thread(opt.connections);
+  std::vector<uint64_t> reconnects(opt.connections, 0);
+  const uint64_t first_ns = requests.front().offset_ns;
+  const auto start = Clock::now();
+
+  std::vector<std::thread> workers;
+  for (unsigned t = 0; t < opt.connections; ++t) {
+    workers.emplace_back([&, t] {
+      Stats& stats = per_thread[t];
+      std::string buf;
+      int fd = -1;
+      for (;;) {
+        size_t i = next.fetch_add(1, std::memory_order_relaxed);
+        if (i >= requests.size()) break;
+
+        auto due = start;
+        if (opt.speed > 0) {
+          due += std::chrono::nanoseconds(static_cast<uint64_t>((requests[i].offset_ns - first_ns) / opt.speed));
+          std::this_thread::sleep_until(due);
+        } else {
+          due = Clock::now();
+        }
+
+        Response resp;
+        // Сервер мог закрыть простаивающее соединение — одна повторная попытка на новом
+        for (int attempt = 0; attempt < 2 && resp.status == 0; ++attempt) {
+          if (fd >= 0 && (attempt > 0 || !still_open(fd))) {
+            close(fd);
+            fd = -1;
+          }
+          if (fd < 0) {
+            fd = connect_target(opt);
+            if (fd < 0) break;
+            ++reconnects[t];
+          }
+          if (send_all(fd, requests[i].bytes)) resp = read_response(fd, buf);
+        }
+        if (fd >= 0 && (!resp.keep_alive || resp.status == 0)) {
+          close(fd);
+          fd = -1;
+        }
+
+        auto latency = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - due).count();
+        RouteStats& rs = stats[routes[i]];
+        rs.latency_us.push_back(static_cast<uint32_t>(std::min<int64_t>(latency, UINT32_MAX)));
+        rs.statuses[resp.status]++;
+        if (resp.status == 0 || resp.status >= 500) rs.errors++;
+      }
+      if (fd >= 0) close(fd);
+    });
+  }
+  for (auto& w : workers) w.join();
+  const double elapsed_s = std::chrono::duration<double>(Clock::now() - start).count();
+
+  Stats total;
+  uint64_t connects = 0;
+  for (unsigned t = 0; t < opt.connections; ++t) {
+    connects += reconnects[t];
+    for (auto& kv : per_thread[t]) {
+      RouteStats& dst = total[kv.first];
+      dst.latency_us.insert(dst.latency_us.end(), kv.second.latency_us.begin(), kv.second.latency_us.end());
+      dst.errors += kv.second.errors;
+      for (const auto& s : kv.second.statuses) dst.statuses[s.first] += s.second;
+    }
+  }
+
+  std::vector<uint32_t> all;
+  std::printf("\n%-44s %8s %9s %7s %9s %9s %9s %9s\n", "route", "count", "req/s", "errors", "p50 ms", "p90 ms", "p99 ms",
+              "max ms");
+  for (auto& kv : total) {
+    auto& lat = kv.second.latency_us;
+    std::sort(lat.begin(), lat.end());
+    all.insert(all.end(), lat.begin(), lat.end());
+    std::printf("%-44s %8zu %9.1f %7llu %9.2f %9.2f %9.2f %9.2f\n", kv.first.c_str(), lat.size(), lat.size() / elapsed_s,
+                static_cast<unsigned long long>(kv.second.errors), percentile(lat, 0.50), percentile(lat, 0.90),
+                percentile(lat, 0.99), lat.back() / 1000.0);
+  }
+  std::sort(all.begin(), all.end());
+  std::printf("%-44s %8zu %9.1f %7s %9.2f %9.2f %9.2f %9.2f\n", "TOTAL", all.size(), all.size() / elapsed_s, "",
+              percentile(all, 0.50), percentile(all, 0.90), percentile(all, 0.99), all.back() / 1000.0);
+  std::printf("\nelapsed %.2f s, connections opened %llu\n", elapsed_s, static_cast<unsigned long long>(connects));
+
+  std::printf("statuses:");
+  std::map<int, uint64_t> statuses;
+  for (const auto& kv : total) {
+    for (const auto& s : kv.second.statuses) statuses[s.first] += s.second;
+  }
+  for (const auto& s : statuses) std::printf(" %d=%llu", s.first, static_cast<unsigned long long>(s.second));
+  std::printf("  (0 = no response)\n");
+  return 0;
+}